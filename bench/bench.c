@@ -0,0 +1,29 @@
+#include <time.h>
+
+#include "bench.h"
+
+volatile int bench_sink;
+
+double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double bench_repeat(void (*fn)(void *arg, unsigned long i), void *arg, unsigned long batch)
+{
+    unsigned long calls = 0;
+    double start = bench_now(), elapsed;
+
+    do {
+        for (unsigned long i = 0; i < batch; i++) {
+            fn(arg, calls + i);
+        }
+        calls += batch;
+        batch *= 2;
+        elapsed = bench_now() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+    return elapsed / calls;
+}
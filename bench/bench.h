@@ -0,0 +1,17 @@
+#ifndef NDWM_BENCH_H
+#define NDWM_BENCH_H
+
+/* Shortest time one measurement runs */
+#define BENCH_MIN_SECONDS 0.2
+
+/* Results are added here so the compiler cannot drop the measured work */
+extern volatile int bench_sink;
+
+double bench_now(void); /* Monotonic clock in seconds */
+
+/* Calls fn(arg, i) for i = 0, 1, ... in batches that start at batch calls
+ * and double until BENCH_MIN_SECONDS have passed. Returns the seconds one
+ * call took on average. */
+double bench_repeat(void (*fn)(void *arg, unsigned long i), void *arg, unsigned long batch);
+
+#endif
@@ -0,0 +1,240 @@
+/* Cache behaviour of the Client record before and after the hot/cold split,
+ * see make bench-clients. The old records are calloc'd one by one as they
+ * were then, the new ones come from slabs like client_init() does now. */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/slab.h"
+#include "../src/utils.h"
+#include "../src/types/client.h"
+
+#define SAMPLES        300
+#define FLUSH_BYTES    (32 << 20)
+#define FOCUS_LOOKUPS  8
+#define FOCUS_CHANGES  64
+#define CLIENT_CHUNK   64
+
+/* Client as it was before the split: title and size hints inline, ahead of
+ * the fields the walks read */
+typedef struct OldClient OldClient;
+struct OldClient {
+    char name[256];
+    float mina, maxa;
+    int x, y, w, h;
+    int sfx, sfy, sfw, sfh;
+    int oldx, oldy, oldw, oldh;
+    int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+    int bw, oldbw;
+    unsigned int tags;
+    int oldstate;
+    unsigned int protocols;
+    int grab_state;
+    struct {
+        int x, y, w, h, bw;
+        unsigned long border;
+        bool border_known, mapped;
+    } server;
+    bool is_floating, is_fixed, is_urgent, is_fullscreen, never_focus;
+    OldClient *next, *prev;
+    OldClient *stack_next, *stack_prev;
+    Window win;
+};
+
+/* Microseconds per sample of each pass, for one record type */
+typedef struct {
+    double walk, showhide, focus;
+} Result;
+
+static const unsigned int client_counts[] = { 100, 500, 2000 };
+
+static unsigned char *flush_buf;
+
+/* Pushes the client records out of the cache, so a sample starts cold like
+ * the first walk after the window manager sat idle */
+static void flush_cache(void)
+{
+    for (size_t i = 0; i < FLUSH_BYTES; i += 64) {
+        flush_buf[i]++;
+    }
+}
+
+/* The list order differs from the allocation order, as it does once windows
+ * have been opened, closed and reordered for a while */
+static void shuffle(unsigned int *order, unsigned int n)
+{
+    for (unsigned int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    srand(1);
+    for (unsigned int i = n - 1; i > 0; i--) {
+        unsigned int j = rand() % (i + 1);
+        unsigned int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+}
+
+/* A tile() walk that assigns geometry to every visible tiled client, then
+ * focus stack lookups and the urgency scan draw_bar() does */
+#define WALK(T, head, stack)                                                        \
+    do {                                                                            \
+        unsigned int i = 0, urg = 0, occ = 0;                                       \
+        for (T *c = (head); c; c = c->next) {                                       \
+            if (c->is_floating || !(c->tags & 1)) {                                 \
+                continue;                                                           \
+            }                                                                       \
+            c->x = i;                                                               \
+            c->y = i * 20;                                                          \
+            c->w = 800;                                                             \
+            c->h = 20;                                                              \
+            i++;                                                                    \
+        }                                                                           \
+        for (unsigned int f = 0; f < FOCUS_LOOKUPS; f++) {                          \
+            T *c = (stack);                                                         \
+            for (; c && !(c->tags & (1u << (f % 2))); c = c->stack_next);           \
+            bench_sink += c ? c->x : 0;                                             \
+            for (c = (head); c; c = c->next) {                                      \
+                occ |= c->tags;                                                     \
+                urg |= c->is_urgent ? c->tags : 0;                                  \
+            }                                                                       \
+        }                                                                           \
+        bench_sink += i + occ + urg;                                                \
+    } while (0)
+
+/* The showhide pass of a switch to shown: visible clients top down, then
+ * hidden ones bottom up over stack_prev, each checked against the server
+ * mirror like client_configure() does */
+#define SHOWHIDE(T, stack, last, shown)                                             \
+    do {                                                                            \
+        unsigned int sent = 0;                                                      \
+        for (T *c = (stack); c; c = c->stack_next) {                                \
+            if ((c->tags & (shown)) && (c->server.x != c->x || c->server.y != c->y  \
+                || c->server.w != c->w || c->server.h != c->h)) {                   \
+                c->server.x = c->x;                                                 \
+                c->server.y = c->y;                                                 \
+                sent++;                                                             \
+            }                                                                       \
+        }                                                                           \
+        for (T *c = (last); c; c = c->stack_prev) {                                 \
+            int x = (c->w + 2 * c->bw) * -2;                                        \
+            if (!(c->tags & (shown)) && (c->server.x != x || c->server.bw != c->bw)) { \
+                c->server.x = x;                                                    \
+                sent++;                                                             \
+            }                                                                       \
+        }                                                                           \
+        bench_sink += sent;                                                         \
+    } while (0)
+
+/* FOCUS_CHANGES focus() calls: each moves a client to the head of the focus
+ * stack with detach_stack() and attach_stack() and clears its urgency */
+#define FOCUS_CHURN(T, stack, records, order, n)                                    \
+    do {                                                                            \
+        for (unsigned int f = 0; f < FOCUS_CHANGES; f++) {                          \
+            T *c = (records)[(order)[(f * 7919u) % (n)]];                          \
+            if (c == (stack)) {                                                     \
+                continue;                                                           \
+            }                                                                       \
+            c->stack_prev->stack_next = c->stack_next;                              \
+            if (c->stack_next) {                                                    \
+                c->stack_next->stack_prev = c->stack_prev;                          \
+            }                                                                       \
+            c->stack_prev = NULL;                                                   \
+            c->stack_next = (stack);                                                \
+            (stack)->stack_prev = c;                                                \
+            (stack) = c;                                                            \
+            c->is_urgent = false;                                                   \
+        }                                                                           \
+    } while (0)
+
+/* Links the records in list order and the focus stack backwards, then times
+ * each pass from a cold cache */
+#define RUN(T, records, order, n, result)                                           \
+    do {                                                                            \
+        for (unsigned int i = 0; i < (n); i++) {                                    \
+            (records)[(order)[i]]->next = i + 1 < (n) ? (records)[(order)[i + 1]] : NULL; \
+            (records)[(order)[i]]->stack_next = i > 0 ? (records)[(order)[i - 1]] : NULL; \
+            (records)[(order)[i]]->stack_prev = i + 1 < (n) ? (records)[(order)[i + 1]] : NULL; \
+        }                                                                           \
+        T *head = (records)[(order)[0]], *stack = (records)[(order)[(n) - 1]];      \
+        for (unsigned int s = 0; s < SAMPLES; s++) {                                \
+            flush_cache();                                                          \
+            double start = bench_now();                                             \
+            WALK(T, head, stack);                                                   \
+            (result)->walk += (bench_now() - start) * 1e6 / SAMPLES;                \
+            T *last = stack;                                                        \
+            for (; last->stack_next; last = last->stack_next);                      \
+            flush_cache();                                                          \
+            start = bench_now();                                                    \
+            SHOWHIDE(T, stack, last, 1u << (s % 2));                                \
+            (result)->showhide += (bench_now() - start) * 1e6 / SAMPLES;            \
+            flush_cache();                                                          \
+            start = bench_now();                                                    \
+            FOCUS_CHURN(T, stack, records, order, n);                               \
+            (result)->focus += (bench_now() - start) * 1e6 / SAMPLES;               \
+        }                                                                           \
+    } while (0)
+
+static Result bench_old(unsigned int n, const unsigned int *order)
+{
+    OldClient **records = ecalloc(n, sizeof(OldClient *));
+    Result result = { 0 };
+
+    for (unsigned int i = 0; i < n; i++) {
+        records[i] = ecalloc(1, sizeof(OldClient));
+        records[i]->tags = i % 3 ? 1 : 2;
+        records[i]->is_urgent = i % 50 == 0;
+        records[i]->bw = 1;
+    }
+    RUN(OldClient, records, order, n, &result);
+    for (unsigned int i = 0; i < n; i++) {
+        free(records[i]);
+    }
+    free(records);
+    return result;
+}
+
+static Result bench_new(unsigned int n, const unsigned int *order)
+{
+    Client **records = ecalloc(n, sizeof(Client *));
+    Slab client_slab = SLAB_INIT(Client, CLIENT_CHUNK);
+    Slab client_cold_slab = SLAB_INIT(ClientCold, CLIENT_CHUNK);
+    Result result = { 0 };
+
+    /* Allocated like client_init() */
+    for (unsigned int i = 0; i < n; i++) {
+        records[i] = slab_alloc(&client_slab);
+        records[i]->cold = slab_alloc(&client_cold_slab);
+        records[i]->tags = i % 3 ? 1 : 2;
+        records[i]->is_urgent = i % 50 == 0;
+        records[i]->bw = 1;
+    }
+    RUN(Client, records, order, n, &result);
+    slab_deinit(&client_slab);
+    slab_deinit(&client_cold_slab);
+    free(records);
+    return result;
+}
+
+int main(void)
+{
+    unsigned int max_n = client_counts[sizeof client_counts / sizeof client_counts[0] - 1];
+    unsigned int *order = ecalloc(max_n, sizeof(unsigned int));
+
+    flush_buf = ecalloc(FLUSH_BYTES, 1);
+    printf("sizeof old client %zu, sizeof client %zu + cold %zu\n",
+           sizeof(OldClient), sizeof(Client), sizeof(ClientCold));
+    printf("%8s  %-10s  %14s  %14s\n", "clients", "pass", "old us/sample", "new us/sample");
+    for (size_t c = 0; c < sizeof client_counts / sizeof client_counts[0]; c++) {
+        unsigned int n = client_counts[c];
+        shuffle(order, n);
+        Result old = bench_old(n, order);
+        Result new = bench_new(n, order);
+        printf("%8u  %-10s  %14.1f  %14.1f\n", n, "walk", old.walk, new.walk);
+        printf("%8u  %-10s  %14.1f  %14.1f\n", n, "showhide", old.showhide, new.showhide);
+        printf("%8u  %-10s  %14.1f  %14.1f\n", n, "focus", old.focus, new.focus);
+    }
+    free(order);
+    free(flush_buf);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+/* Layouts per second of the pure layout core, and the client walk that
+ * feeds it, see make bench-layout */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "../src/arrange.h"
+#include "../src/layout.h"
+#include "../src/utils.h"
+
+typedef struct {
+    const char *name;
+    unsigned int hinted_every; /* Every nth window carries size hints, 0 for none */
+} HintMix;
+
+static const Layout layouts[] = {
+    { "tile",    layout_tile,    false },
+    { "monocle", layout_monocle, true  },
+    { "grid",    layout_grid,    false },
+};
+static const unsigned int client_counts[] = { 1, 2, 10, 50, 200, 500, 1000 };
+static const HintMix mixes[] = {
+    { "no hints",   0 },
+    { "1/4 hinted", 4 },
+    { "all hinted", 1 },
+};
+
+/* Client lists for the walk comparison. The first hidden clients are on
+ * another tag and sit ahead of the visible ones, every other visible client
+ * is on both tags when mixed is set. With nothing hidden ahead, the old walk
+ * was already linear, so the first case is a control. */
+typedef struct {
+    const char *name;
+    unsigned int clients, hidden;
+    bool mixed;
+} WalkCase;
+
+static const WalkCase walk_cases[] = {
+    { "visible first (control)",      500,    0, true  },
+    { "400 hidden ahead of 100",      500,  400, false },
+    { "1600 hidden ahead of 400",    2000, 1600, false },
+};
+
+/* A terminal-like client: base size, character cell increments and an aspect range */
+static const SizeHints term_hints = {
+    .mina = 0.25f, .maxa = 4.0f, .basew = 4, .baseh = 4, .incw = 7, .inch = 15,
+    .minw = 32, .minh = 19,
+};
+
+/* One measured layout case */
+typedef struct {
+    const Layout *layout;
+    const HintMix *mix;
+    unsigned int n;
+    LayoutSlot *slots;
+    Rect *current;
+} LayoutCase;
+
+/* One measured walk over the client list of a monitor */
+typedef struct {
+    unsigned int (*walk)(Monitor *);
+    Monitor *mon;
+} WalkRun;
+
+/* One arrange as ndwm does it: run the layout, then constrain each slot it configures */
+static void run_layout(const Layout *layout, unsigned int n, const HintMix *mix, LayoutSlot *slots, Rect *current)
+{
+    const LayoutParams params = { { 0, 20, 2560, 1420 }, 0.55f, 1, 0, 1, 20 };
+
+    layout->arrange(&params, n, slots);
+    for (unsigned int i = 0; i < n; i++) {
+        const SizeHints *hints = mix->hinted_every && i % mix->hinted_every == 0 ? &term_hints : NULL;
+        if (!slots[i].configure) {
+            continue;
+        }
+        Rect r = slots[i].geom;
+        if (layout_apply_size_hints(&r, &current[i], 1, params.area, false, 20, hints)) {
+            current[i] = r;
+        }
+    }
+    bench_sink += current[n - 1].h;
+}
+
+static void layout_pass(void *arg, unsigned long i)
+{
+    LayoutCase *lc = arg;
+
+    /* Invalidate one window's geometry so every pass reports a change */
+    lc->current[i % lc->n].w = 0;
+    run_layout(lc->layout, lc->n, lc->mix, lc->slots, lc->current);
+}
+
+static void bench_case(const Layout *layout, const HintMix *mix, unsigned int n, LayoutSlot *slots, Rect *current)
+{
+    LayoutCase lc = { layout, mix, n, slots, current };
+    double seconds = bench_repeat(layout_pass, &lc, 64);
+
+    printf("%-8s  %8u  %-10s  %14.0f  %12.1f\n", layout->symbol, n, mix->name, 1 / seconds,
+           seconds * 1e9 / n);
+}
+
+/* arrange.c is linked for update_tiled(), which uses none of these */
+const ArrangeConfig arrange_config = { 1, 0.55f, false };
+
+bool client_configure(Client *c, int x, int y, int w, int h, int bw)
+{
+    (void)c; (void)x; (void)y; (void)w; (void)h; (void)bw;
+    return false;
+}
+
+void client_hide(Client *c, bool iconic)
+{
+    (void)c; (void)iconic;
+}
+
+void client_show(Client *c)
+{
+    (void)c;
+}
+
+void resize(Client *c, int x, int y, int w, int h, bool interact, bool sole)
+{
+    (void)c; (void)x; (void)y; (void)w; (void)h; (void)interact; (void)sole;
+}
+
+/* Shown tagset of the walk comparison */
+#define SHOWN 1u
+
+static Client *next_tiled(Client *c)
+{
+    for (; c && (c->is_floating || !(c->tags & SHOWN)); c = c->next);
+    return c;
+}
+
+/* In ndwm the list head was reread after the X calls of every resize, this
+ * keeps the compiler from hoisting those walks out of the loop */
+static Client *volatile list_head;
+
+/* Before the tiled array: tile() counted the tiled clients with one walk and
+ * for each of them resize_client() asked next_tiled() on the list head and on
+ * c->next, twice each, whether c was the only tiled client */
+static unsigned int walk_old(Monitor *m)
+{
+    unsigned int n = 0, sole = 0;
+    Client *c;
+
+    list_head = m->clients;
+    for (c = next_tiled(list_head); c; c = next_tiled(c->next), n++);
+    for (c = next_tiled(list_head); c; c = next_tiled(c->next)) {
+        sole += next_tiled(list_head) == c && !next_tiled(c->next);
+        sole += next_tiled(list_head) == c && !next_tiled(c->next);
+    }
+    return n + sole;
+}
+
+/* update_tiled() as ndwm runs it, sole is n == 1 */
+static unsigned int walk_new(Monitor *m)
+{
+    update_tiled(m);
+    return m->tiled_len + (m->tiled_len == 1);
+}
+
+static void walk_pass(void *arg, unsigned long i)
+{
+    WalkRun *run = arg;
+
+    (void)i;
+    bench_sink += run->walk(run->mon);
+}
+
+/* Microseconds per call of walk over the list */
+static double time_walk(unsigned int (*walk)(Monitor *), Monitor *m)
+{
+    WalkRun run = { walk, m };
+
+    return bench_repeat(walk_pass, &run, 16) * 1e6;
+}
+
+static void bench_walks(void)
+{
+    printf("\n%-28s  %8s  %12s  %12s\n", "tile walk", "clients", "old us", "new us");
+    for (size_t w = 0; w < sizeof walk_cases / sizeof walk_cases[0]; w++) {
+        const WalkCase *wc = &walk_cases[w];
+        Client *clients = ecalloc(wc->clients, sizeof(Client));
+        Monitor mon = { .clients = clients, .tagset = { SHOWN, SHOWN } };
+
+        for (unsigned int i = 0; i < wc->clients; i++) {
+            clients[i].next = i + 1 < wc->clients ? &clients[i + 1] : NULL;
+            clients[i].tags = i < wc->hidden ? SHOWN << 1 : SHOWN;
+            if (wc->mixed && i % 2) {
+                clients[i].tags |= SHOWN << 1;
+            }
+        }
+        double old_us = time_walk(walk_old, &mon);
+        double new_us = time_walk(walk_new, &mon);
+        printf("%-28s  %8u  %12.1f  %12.1f\n", wc->name, wc->clients, old_us, new_us);
+        free(clients);
+        free(mon.tiled);
+    }
+}
+
+int main(void)
+{
+    unsigned int max_n = client_counts[sizeof client_counts / sizeof client_counts[0] - 1];
+    LayoutSlot *slots = ecalloc(max_n, sizeof(LayoutSlot));
+    Rect *current = ecalloc(max_n, sizeof(Rect));
+
+    printf("%-8s  %8s  %-10s  %14s  %12s\n", "layout", "clients", "hints", "layouts/s", "ns/client");
+    for (size_t l = 0; l < sizeof layouts / sizeof layouts[0]; l++) {
+        for (size_t m = 0; m < sizeof mixes / sizeof mixes[0]; m++) {
+            for (size_t c = 0; c < sizeof client_counts / sizeof client_counts[0]; c++) {
+                bench_case(&layouts[l], &mixes[m], client_counts[c], slots, current);
+            }
+        }
+    }
+    free(slots);
+    free(current);
+    bench_walks();
+    return EXIT_SUCCESS;
+}
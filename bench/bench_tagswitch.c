@@ -0,0 +1,171 @@
+/* Cost of a tag switch, see make bench-tagswitch. Runs what flush_monitor()
+ * does after view(), the showhide(), update_tiled() and apply_layout() of
+ * src/arrange.c, on a monitor with no X server behind it. The client
+ * functions arrange.c calls are defined here and count requests against the
+ * server mirror as ndwm.c does, nothing is sent anywhere. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "../src/arrange.h"
+#include "../src/layout.h"
+#include "../src/utils.h"
+
+#define TAGS       9
+#define MIN_SIZE   20
+#define BORDER_PX  1
+
+static const unsigned int client_counts[] = { 90, 450, 900, 2700 };
+static const Rect area = { 0, 20, 2560, 1420 };
+static const Layout tile = { "[]=", layout_tile, false };
+
+/* Hidden clients move off screen, the default of config.h */
+const ArrangeConfig arrange_config = { BORDER_PX, 0.55f, false };
+
+static unsigned long requests;
+
+/* Only fields that differ from the mirror go out */
+bool client_configure(Client *c, int x, int y, int w, int h, int bw)
+{
+    if (x == c->server.x && y == c->server.y && w == c->server.w && h == c->server.h && bw == c->server.bw) {
+        return false;
+    }
+    c->server.x = x;
+    c->server.y = y;
+    c->server.w = w;
+    c->server.h = h;
+    c->server.bw = bw;
+    requests++;
+    return true;
+}
+
+/* Not called with hide_by_unmap off */
+void client_hide(Client *c, bool iconic)
+{
+    (void)c; (void)iconic;
+}
+
+void client_show(Client *c)
+{
+    (void)c;
+}
+
+/* Size hints, then one request plus the synthetic ConfigureNotify for a
+ * client that moves. No client here has hints or is alone on its tag. */
+void resize(Client *c, int x, int y, int w, int h, bool interact, bool sole)
+{
+    Rect r = { x, y, w, h }, cur = { c->x, c->y, c->w, c->h };
+
+    (void)sole;
+    if (layout_apply_size_hints(&r, &cur, c->bw, area, interact, MIN_SIZE, NULL)) {
+        c->x = r.x;
+        c->y = r.y;
+        c->w = r.w;
+        c->h = r.h;
+        if (client_configure(c, c->x, c->y, c->w, c->h, c->bw)) {
+            requests++;
+        }
+    }
+}
+
+typedef struct {
+    Monitor mon;
+    Pertag pertag;
+    Client *clients;
+    ClientCold *cold;
+    unsigned int n;
+    bool forget;                     /* Clear the slot records of a tag before showing it */
+    unsigned long switches;
+} Model;
+
+/* view() and the flush after it, without the focus and bar work */
+static void model_view(void *arg, unsigned long i)
+{
+    Model *m = arg;
+    unsigned int tag = i % TAGS;
+
+    m->mon.tagset[m->mon.seltags] = (Tagset)1 << tag;
+    m->pertag.current_tag = tag + 1;
+    if (m->forget) {
+        /* As before slots were recorded: every tiled client goes through
+         * resize() again. Clients sit round robin on the tags. */
+        for (Client *c = &m->clients[tag]; c < m->clients + m->n; c += TAGS) {
+            c->cold->slot_sole = true;
+        }
+    }
+    showhide(&m->mon);
+    update_tiled(&m->mon);
+    apply_layout(&m->mon);
+    m->switches++;
+    bench_sink += m->mon.tiled_len;
+}
+
+/* n clients spread round robin over the tags, the focus stack runs the list backwards */
+static void model_init(Model *m, unsigned int n, bool forget)
+{
+    memset(m, 0, sizeof(*m));
+    m->n = n;
+    m->forget = forget;
+    m->clients = ecalloc(n, sizeof(Client));
+    m->cold = ecalloc(n, sizeof(ClientCold));
+    for (unsigned int i = 0; i < n; i++) {
+        Client *c = &m->clients[i];
+        c->cold = &m->cold[i];
+        c->next = i + 1 < n ? &m->clients[i + 1] : NULL;
+        c->stack_next = i > 0 ? &m->clients[i - 1] : NULL;
+        c->stack_prev = i + 1 < n ? &m->clients[i + 1] : NULL;
+        c->tags = (Tagset)1 << (i % TAGS);
+        c->bw = BORDER_PX;
+    }
+    m->mon.clients = m->clients;
+    m->mon.stack = &m->clients[n - 1];
+    m->mon.pertag = &m->pertag;
+    m->mon.layout = &tile;
+    m->mon.master_factor = arrange_config.master_factor;
+    m->mon.nmaster = 1;
+    m->mon.wx = area.x;
+    m->mon.wy = area.y;
+    m->mon.ww = area.w;
+    m->mon.wh = area.h;
+    m->mon.bh = MIN_SIZE;
+}
+
+static void model_deinit(Model *m)
+{
+    free(m->clients);
+    free(m->cold);
+    free(m->mon.tiled);
+    free(m->mon.slots);
+}
+
+/* Cycles view() over every tag, after one warm-up round that lays each tag out */
+static void bench_case(unsigned int n, bool forget, double *ns, double *reqs)
+{
+    Model m;
+
+    model_init(&m, n, forget);
+    for (unsigned int t = 0; t < TAGS; t++) {
+        model_view(&m, t);
+    }
+    requests = 0;
+    m.switches = 0;
+    *ns = bench_repeat(model_view, &m, TAGS) * 1e9;
+    *reqs = (double)requests / m.switches;
+    model_deinit(&m);
+}
+
+int main(void)
+{
+    printf("%8s  %14s  %14s  %14s  %14s\n", "windows", "forgotten ns", "kept ns",
+           "forgotten reqs", "kept reqs");
+    for (size_t c = 0; c < sizeof client_counts / sizeof client_counts[0]; c++) {
+        double forgotten_ns, kept_ns, forgotten_reqs, kept_reqs;
+
+        bench_case(client_counts[c], true, &forgotten_ns, &forgotten_reqs);
+        bench_case(client_counts[c], false, &kept_ns, &kept_reqs);
+        printf("%8u  %14.0f  %14.0f  %14.1f  %14.1f\n", client_counts[c], forgotten_ns, kept_ns,
+               forgotten_reqs, kept_reqs);
+    }
+    return EXIT_SUCCESS;
+}
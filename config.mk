@@ -25,7 +25,7 @@ FREETYPEINC = /usr/include/freetype2
 
 # Includes and libs
 INCS = -I${X11INC} -I${FREETYPEINC}
-LDFLAGS = -L${X11LIB} -lX11 ${FREETYPELIBS}
+LDFLAGS = -L${X11LIB} -lX11 -lX11-xcb -lxcb ${FREETYPELIBS}
 
 # Flags
 COPTIONS = -pedantic -Wall -Wextra -Wunused -Wunused-function -Wunused-local-typedefs -Wunused-macros -Os
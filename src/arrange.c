@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arrange.h"
+#include "utils.h"
+
+#define VISIBLE(M, C) ((C)->tags & (M)->tagset[(M)->seltags])
+
+unsigned long relayout_skipped = 0;
+
+void showhide(Monitor *m)
+{
+    Client *c = m->stack;
+    Client *last = NULL;
+
+    /* Show clients top down */
+    for (; c; last = c, c = c->stack_next) {
+        if (!VISIBLE(m, c)) {
+            continue;
+        }
+        client_configure(c, c->x, c->y, c->server.w, c->server.h, c->server.bw);
+        if (c->is_floating && !c->is_fullscreen) {
+            resize(c, c->x, c->y, c->w, c->h, false, false);
+        }
+        if (arrange_config.hide_by_unmap && (c->is_floating || !m->layout->follows_focus)) {
+            /* Tiled clients wait for show_layout_top */
+            client_show(c);
+        }
+    }
+    /* Hide clients bottom up */
+    for (c = last; c; c = c->stack_prev) {
+        if (VISIBLE(m, c)) {
+            continue;
+        }
+        if (arrange_config.hide_by_unmap) {
+            client_hide(c, true);
+        } else {
+            client_configure(c, WIDTH(c) * -2, c->y, c->server.w, c->server.h, c->server.bw);
+        }
+    }
+}
+
+/* With hide_by_unmap, a follows_focus layout keeps only m->layout_top of the
+ * tiled clients mapped instead of leaving the others at their old geometry
+ * underneath it. Maps the new one before unmapping the old one, so the
+ * background never shows through. The covered ones are still on a shown
+ * tag and are not iconified. */
+void show_layout_top(Monitor *m)
+{
+    if (!m->layout_top) {
+        return;
+    }
+    client_show(m->layout_top);
+    for (unsigned int i = 0; i < m->tiled_len; i++) {
+        if (m->tiled[i] != m->layout_top) {
+            client_hide(m->tiled[i], false);
+        }
+    }
+}
+
+/* One walk, so layouts never rescan the list */
+void update_tiled(Monitor *m)
+{
+    unsigned int n = 0;
+
+    for (Client *c = m->clients; c; c = c->next, n++);
+    if (n > m->tiled_cap) {
+        m->tiled_cap = MAX(n, 2 * m->tiled_cap);
+        free(m->tiled);
+        free(m->slots);
+        m->tiled = ecalloc(m->tiled_cap, sizeof(Client *));
+        m->slots = ecalloc(m->tiled_cap, sizeof(LayoutSlot));
+    }
+    m->tiled_len = 0;
+    for (Client *c = m->clients; c; c = c->next) {
+        if (!c->is_floating && VISIBLE(m, c)) {
+            m->tiled[m->tiled_len++] = c;
+        }
+    }
+}
+
+/* Runs the layout of the current tag and configures only the clients it
+ * reports, monocle leaves everything but the shown client alone */
+void apply_layout(Monitor *m)
+{
+    unsigned int n = m->tiled_len;
+    /* Every tiled client has arrange_config.borderpx, see toggle_floating and configure_request */
+    LayoutParams params = { { m->wx, m->wy, m->ww, m->wh }, m->master_factor, m->nmaster, n, arrange_config.borderpx, m->bh };
+
+    if (n == 1) {
+        m->master_factor = arrange_config.master_factor;
+    }
+    m->layout_top = NULL;
+    if (m->layout->follows_focus) {
+        /* Show the most recently focused tiled client */
+        for (Client *c = m->stack; c && !m->layout_top; c = c->stack_next) {
+            if (!c->is_floating && VISIBLE(m, c)) {
+                m->layout_top = c;
+            }
+        }
+        for (params.selected = 0; params.selected < n && m->tiled[params.selected] != m->layout_top; params.selected++);
+    }
+    m->layout->arrange(&params, n, m->slots);
+    for (unsigned int i = 0; i < n; i++) {
+        Client *c = m->tiled[i];
+        ClientCold *cold = c->cold;
+        Rect *s = &m->slots[i].geom;
+        if (!m->slots[i].configure) {
+            continue;
+        }
+        /* Incremental relayout: a client that still has the slot it got last
+         * time and has not been moved since keeps its geometry, so closing a
+         * stack window leaves the master alone */
+        if (cold->slot_sole == (n == 1) && !memcmp(&cold->slot, s, sizeof(Rect))
+        && cold->laid.x == c->x && cold->laid.y == c->y && cold->laid.w == c->w && cold->laid.h == c->h) {
+            relayout_skipped++;
+            continue;
+        }
+        resize(c, s->x, s->y, s->w, s->h, false, n == 1);
+        cold->slot = *s;
+        cold->slot_sole = n == 1;
+        cold->laid = (Rect){ c->x, c->y, c->w, c->h };
+    }
+}
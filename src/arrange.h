@@ -0,0 +1,38 @@
+#ifndef NDWM_ARRANGE_H
+#define NDWM_ARRANGE_H
+
+#include <stdbool.h>
+#include "monitor.h"
+
+/* Placement of the clients of a monitor after a change: which ones are
+ * shown and where the layout of the current tag puts them. Nothing in here
+ * talks to the X server or reads config.h. Requests go out through the
+ * client functions below and settings come in through arrange_config,
+ * which ndwm.c defines and the benches replace with their own. */
+
+typedef struct {
+    int borderpx;          /* Border of every tiled client */
+    float master_factor;   /* Restored once a single tiled client is left */
+    bool hide_by_unmap;    /* Unmap hidden clients instead of moving them off screen */
+} ArrangeConfig;
+
+extern const ArrangeConfig arrange_config;
+
+extern unsigned long relayout_skipped; /* Clients whose slot did not change in a relayout */
+
+/* Provided by the caller */
+bool client_configure(Client *c, int x, int y, int w, int h, int bw);
+void client_hide(Client *c, bool iconic);
+void client_show(Client *c);
+void resize(Client *c, int x, int y, int w, int h, bool interact, bool sole);
+
+/* Moves the shown clients of m back and the others off screen, or unmaps them */
+void showhide(Monitor *m);
+/* Collects the visible tiled clients of m into m->tiled */
+void update_tiled(Monitor *m);
+/* Lays out the current tag of m */
+void apply_layout(Monitor *m);
+/* Leaves only the client a follows_focus layout shows mapped among the tiled ones */
+void show_layout_top(Monitor *m);
+
+#endif
@@ -20,6 +20,7 @@ static const char *fonts[] = { "Terminus (TTF):style=Medium:size=9",
 
 static const bool top_bar             = true;
 static const bool show_title          = true;
+static const bool hide_by_unmap       = false; /* Unmap clients on hidden tags instead of moving them off screen */
 static const unsigned int systrayspacing = 2;
 
 /* TODO: There are some variables that should be user-defined, namely:
@@ -29,7 +30,18 @@ static const unsigned int systrayspacing = 2;
  * resize_step
 */
 
+/* Up to 64 tags */
+static const char *tags[] = { "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+
 static const float master_factor = 0.52; /* Factor of master width size [0.05..0.95] */
+static const unsigned int nmaster = 1;    /* Number of clients in the master area */
+
+static const Layout layouts[] = {
+    /* symbol     arrange function    follows focus */
+    { "[]=",      layout_tile,        false },    /* First entry is default */
+    { "[M]",      layout_monocle,     true  },
+    { "###",      layout_grid,        false },
+};
 
 #define MODKEY Mod4Mask
 
@@ -42,8 +54,8 @@ static const char *colors[][3] = {
 };
 
 #define TAGKEYS(KEY,TAG) \
-    { MODKEY,                       KEY,      view,           {.ui = 1 << TAG} }, \
-    { MODKEY|ShiftMask,             KEY,      tag,            {.ui = 1 << TAG} }, \
+    { MODKEY,                       KEY,      view,           {.tags = TAGBIT(TAG)} }, \
+    { MODKEY|ShiftMask,             KEY,      tag,            {.tags = TAGBIT(TAG)} }, \
 
 #define SHCMD(cmd) { .v = (const char*[]){ "/bin/sh", "-c", cmd, NULL } }
 
@@ -90,6 +102,11 @@ static const Key keys[] = {
     { MODKEY,                       XK_l,      increase_master_width,          {0} },
     { MODKEY,                       XK_h,      decrease_master_width,          {0} },
     { MODKEY,                       XK_z,      make_master,                    {0} },
+    { MODKEY,                       XK_i,      increase_nmaster,               { .i = +1 } },
+    { MODKEY|ShiftMask,             XK_i,      increase_nmaster,               { .i = -1 } },
+    { MODKEY,                       XK_t,      set_layout,                     { .v = &layouts[0] } },
+    { MODKEY,                       XK_m,      set_layout,                     { .v = &layouts[1] } },
+    { MODKEY,                       XK_g,      set_layout,                     { .v = &layouts[2] } },
     { MODKEY|ShiftMask,             XK_r,      quit,                           {0} },
 };
 
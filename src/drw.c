@@ -1,4 +1,5 @@
 #include <fontconfig/fontconfig.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -60,37 +61,98 @@ static size_t utf8decode(const char *c, long *u, size_t clen)
     return len;
 }
 
-Drw *drw_create(Display *dpy, int screen, Window root, unsigned int w, unsigned int h)
+Drw *drw_create(Display *dpy, int screen, Window root)
 {
     Drw *drw = ecalloc(1, sizeof(Drw));
     drw->dpy = dpy;
     drw->screen = screen;
     drw->root = root;
-    drw->w = w;
-    drw->h = h;
-    drw->drawable = XCreatePixmap(dpy, root, w, h, DefaultDepth(dpy, screen));
     drw->gc = XCreateGC(dpy, root, 0, NULL);
     XSetLineAttributes(dpy, drw->gc, 1, LineSolid, CapButt, JoinMiter);
 
     return drw;
 }
 
-void drw_resize(Drw *drw, unsigned int w, unsigned int h)
+/* Draws into drawable from now on, e.g. the bar buffer of a monitor */
+void drw_set_target(Drw *drw, Drawable drawable, unsigned int w, unsigned int h)
 {
     if (!drw) {
         return;
     }
+    drw->drawable = drawable;
     drw->w = w;
     drw->h = h;
-    if (drw->drawable) {
-        XFreePixmap(drw->dpy, drw->drawable);
+}
+
+static void width_cache_clear(Drw *drw)
+{
+    for (size_t s = 0; s < WIDTH_CACHE_SETS; s++) {
+        for (size_t i = 0; i < WIDTH_CACHE_WAYS; i++) {
+            free(drw->widths[s][i].text);
+            drw->widths[s][i].text = NULL;
+        }
+    }
+}
+
+static void coverage_free(Drw *drw)
+{
+    if (!drw->coverage) {
+        return;
+    }
+    for (size_t i = 0; i < COVERAGE_PAGES; i++) {
+        free(drw->coverage->pages[i]);
     }
-    drw->drawable = XCreatePixmap(drw->dpy, drw->root, w, h, DefaultDepth(drw->dpy, drw->screen));
+    free(drw->coverage);
+    drw->coverage = NULL;
+}
+
+/* Gives font the next index. Fonts past COVERAGE_MAX_FONTS get none and are
+ * found by walking the chain instead. */
+static bool coverage_add_font(Drw *drw, Fnt *font)
+{
+    if (drw->coverage->len >= COVERAGE_MAX_FONTS) {
+        return false;
+    }
+    drw->coverage->fonts[drw->coverage->len++] = font;
+    return true;
+}
+
+static void coverage_set(Drw *drw, long codepoint, unsigned int font)
+{
+    unsigned char **page = &drw->coverage->pages[codepoint >> COVERAGE_PAGE_BITS];
+
+    if (!*page) {
+        *page = ecalloc(1 << COVERAGE_PAGE_BITS, 1);
+    }
+    (*page)[codepoint & ((1 << COVERAGE_PAGE_BITS) - 1)] = font + 1;
+}
+
+/* First font of the chain with a glyph for codepoint, NULL if none has one.
+ * Only the first lookup of a codepoint asks Xft. */
+static Fnt *coverage_lookup(Drw *drw, long codepoint)
+{
+    Coverage *coverage = drw->coverage;
+    const unsigned char *page = coverage->pages[codepoint >> COVERAGE_PAGE_BITS];
+    unsigned int index = 0;
+
+    if (page && page[codepoint & ((1 << COVERAGE_PAGE_BITS) - 1)]) {
+        return coverage->fonts[page[codepoint & ((1 << COVERAGE_PAGE_BITS) - 1)] - 1];
+    }
+    for (Fnt *font = drw->fonts; font; font = font->next, index++) {
+        if (XftCharExists(drw->dpy, font->xfont, codepoint)) {
+            if (index < coverage->len) {
+                coverage_set(drw, codepoint, index);
+            }
+            return font;
+        }
+    }
+    return NULL;
 }
 
 void drw_free(Drw *drw)
 {
-    XFreePixmap(drw->dpy, drw->drawable);
+    width_cache_clear(drw);
+    coverage_free(drw);
     XFreeGC(drw->dpy, drw->gc);
     drw_fontset_free(drw->fonts);
     free(drw);
@@ -161,6 +223,14 @@ Fnt* drw_fontset_create(Drw* drw, const char *fonts[], size_t fontcount)
             ret = cur;
         }
     }
+    width_cache_clear(drw);
+    coverage_free(drw);
+    if (ret) {
+        drw->coverage = ecalloc(1, sizeof(Coverage));
+        for (cur = ret; cur; cur = cur->next) {
+            coverage_add_font(drw, cur);
+        }
+    }
     return (drw->fonts = ret);
 }
 
@@ -222,7 +292,6 @@ int drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned in
     Fnt *usedfont, *curfont, *nextfont;
     int utf8strlen, utf8charlen, render = x || y || w || h;
     long utf8codepoint = 0;
-    int charexists = 0;
 
     if (!drw || (render && !drw->scheme) || !text || !drw->fonts) {
         return 0;
@@ -242,28 +311,19 @@ int drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned in
 
     usedfont = drw->fonts;
     while (1) {
+        /* Extend the run while the coverage table picks the same font */
         utf8strlen = 0;
         const char *utf8str = text;
         nextfont = NULL;
         while (*text) {
             utf8charlen = utf8decode(text, &utf8codepoint, UTF_SIZ);
-            for (curfont = drw->fonts; curfont; curfont = curfont->next) {
-                charexists = charexists || XftCharExists(drw->dpy, curfont->xfont, utf8codepoint);
-                if (charexists) {
-                    if (curfont == usedfont) {
-                        utf8strlen += utf8charlen;
-                        text += utf8charlen;
-                    } else {
-                        nextfont = curfont;
-                    }
-                    break;
-                }
-            }
-            if (!charexists || nextfont) {
+            curfont = coverage_lookup(drw, utf8codepoint);
+            if (curfont != usedfont) {
+                nextfont = curfont;
                 break;
-            } else {
-                charexists = 0;
             }
+            utf8strlen += utf8charlen;
+            text += utf8charlen;
         }
 
         if (utf8strlen) {
@@ -294,11 +354,10 @@ int drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned in
         if (!*text) {
             break;
         } else if (nextfont) {
-            charexists = 0;
             usedfont = nextfont;
         } else {
             /* Regardless of whether or not a fallback font is found, the character must be drawn. */
-            charexists = 1;
+            usedfont = NULL;
 
             FcCharSet *fccharset = FcCharSetCreate();
             FcCharSetAddChar(fccharset, utf8codepoint);
@@ -322,15 +381,23 @@ int drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned in
             FcPatternDestroy(fcpattern);
 
             if (match) {
-                usedfont = xfont_create(drw, NULL, match);
-                if (usedfont && XftCharExists(drw->dpy, usedfont->xfont, utf8codepoint)) {
+                Fnt *fallback = xfont_create(drw, NULL, match);
+                if (fallback && XftCharExists(drw->dpy, fallback->xfont, utf8codepoint)) {
                     for (curfont = drw->fonts; curfont->next; curfont = curfont->next);
-                    curfont->next = usedfont;
+                    curfont->next = fallback;
+                    if (coverage_add_font(drw, fallback)) {
+                        coverage_set(drw, utf8codepoint, drw->coverage->len - 1);
+                    }
+                    usedfont = fallback;
                 } else {
-                    xfont_free(usedfont);
-                    usedfont = drw->fonts;
+                    xfont_free(fallback);
                 }
             }
+            if (!usedfont) {
+                /* No font has it, the first one draws it from now on */
+                coverage_set(drw, utf8codepoint, 0);
+                usedfont = drw->fonts;
+            }
         }
     }
     if (d) {
@@ -346,15 +413,53 @@ void drw_map(Drw *drw, Window win, int x, int y, unsigned int w, unsigned int h)
     }
 
     XCopyArea(drw->dpy, drw->drawable, win, drw->gc, x, y, w, h, x, y);
-    XSync(drw->dpy, False);
 }
 
+/* FNV-1a */
+static unsigned int text_hash(const char *text)
+{
+    unsigned int hash = 2166136261u;
+
+    for (; *text; text++) {
+        hash = (hash ^ (unsigned char)*text) * 16777619u;
+    }
+    return hash;
+}
+
+/* Widths are cached by text and font set, so repeated measurements of tags,
+ * layout symbols, titles and status do not reach Xft */
 unsigned int drw_fontset_getwidth(Drw *drw, const char *text)
 {
     if (!drw || !drw->fonts || !text) {
         return 0;
     }
-    return drw_text(drw, 0, 0, 0, 0, 0, text, 0);
+    unsigned int hash = text_hash(text);
+    WidthEntry *set = drw->widths[hash % WIDTH_CACHE_SETS];
+    WidthEntry *victim = &set[0];
+
+    for (size_t i = 0; i < WIDTH_CACHE_WAYS; i++) {
+        WidthEntry *e = &set[i];
+        if (e->text && e->hash == hash && e->fonts == drw->fonts && !strcmp(e->text, text)) {
+            e->used = ++drw->width_clock;
+            drw->width_hits++;
+            return e->width;
+        }
+        if (!e->text || (victim->text && e->used < victim->used)) {
+            victim = e;
+        }
+    }
+    drw->width_misses++;
+    unsigned int width = drw_text(drw, 0, 0, 0, 0, 0, text, 0);
+    char *copy = strdup(text);
+    if (copy) {
+        free(victim->text);
+        victim->text = copy;
+        victim->fonts = drw->fonts;
+        victim->hash = hash;
+        victim->width = width;
+        victim->used = ++drw->width_clock;
+    }
+    return width;
 }
 
 void drw_font_getexts(Fnt *font, const char *text, unsigned int len, unsigned int *w, unsigned int *h)
@@ -20,20 +20,49 @@ enum { ColFg, ColBg, ColBorder }; /* Clr scheme index */
 
 typedef XftColor Clr;
 
+/* Text width cache: WIDTH_CACHE_SETS sets of WIDTH_CACHE_WAYS entries, least
+ * recently used entry of a set is replaced */
+#define WIDTH_CACHE_SETS 64
+#define WIDTH_CACHE_WAYS 4
+
+/* Which font of the chain draws each codepoint. Pages of 256 codepoints are
+ * allocated when first touched and hold the index + 1 of the font, 0 for
+ * codepoints not looked up yet. */
+#define COVERAGE_PAGE_BITS 8
+#define COVERAGE_PAGES     (0x110000 >> COVERAGE_PAGE_BITS)
+#define COVERAGE_MAX_FONTS 255
+
+typedef struct {
+    unsigned char *pages[COVERAGE_PAGES];
+    Fnt *fonts[COVERAGE_MAX_FONTS]; /* The font chain by index */
+    unsigned int len;
+} Coverage;
+
+typedef struct {
+    char *text;           /* NULL when the entry is free */
+    Fnt *fonts;           /* Font set the width was measured with */
+    unsigned int hash, width;
+    unsigned long used;   /* LRU stamp */
+} WidthEntry;
+
 typedef struct {
-    unsigned int w, h;
+    unsigned int w, h;     /* Size of drawable */
     Display *dpy;
     int screen;
     Window root;
-    Drawable drawable;
+    Drawable drawable;     /* Target of the drawing functions, owned by the caller */
     GC gc;
     Clr *scheme;
     Fnt *fonts;
+    Coverage *coverage;
+    WidthEntry widths[WIDTH_CACHE_SETS][WIDTH_CACHE_WAYS];
+    unsigned long width_clock;
+    unsigned long width_hits, width_misses;
 } Drw;
 
 /* Drawable abstraction */
-Drw *drw_create(Display *dpy, int screen, Window win, unsigned int w, unsigned int h);
-void drw_resize(Drw *drw, unsigned int w, unsigned int h);
+Drw *drw_create(Display *dpy, int screen, Window win);
+void drw_set_target(Drw *drw, Drawable drawable, unsigned int w, unsigned int h);
 void drw_free(Drw *drw);
 
 /* Fnt abstraction */
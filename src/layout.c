@@ -0,0 +1,159 @@
+#include "layout.h"
+#include "utils.h"
+
+bool layout_apply_size_hints(Rect *r, const Rect *cur, int bw, Rect bounds, bool interact,
+                             int min_size, const SizeHints *hints)
+{
+    /* Set minimum possible */
+    r->w = MAX(1, r->w);
+    r->h = MAX(1, r->h);
+    if (interact) {
+        if (r->x > bounds.x + bounds.w) {
+            r->x = bounds.x + bounds.w - (cur->w + 2 * bw);
+        }
+        if (r->y > bounds.y + bounds.h) {
+            r->y = bounds.y + bounds.h - (cur->h + 2 * bw);
+        }
+        if (r->x + r->w + 2 * bw < bounds.x) {
+            r->x = bounds.x;
+        }
+        if (r->y + r->h + 2 * bw < bounds.y) {
+            r->y = bounds.y;
+        }
+    } else {
+        if (r->x >= bounds.x + bounds.w) {
+            r->x = bounds.x + bounds.w - (cur->w + 2 * bw);
+        }
+        if (r->y >= bounds.y + bounds.h) {
+            r->y = bounds.y + bounds.h - (cur->h + 2 * bw);
+        }
+        if (r->x + r->w + 2 * bw <= bounds.x) {
+            r->x = bounds.x;
+        }
+        if (r->y + r->h + 2 * bw <= bounds.y) {
+            r->y = bounds.y;
+        }
+    }
+    if (r->h < min_size) {
+        r->h = min_size;
+    }
+    if (r->w < min_size) {
+        r->w = min_size;
+    }
+    if (hints) {
+        /* See last two sentences in ICCCM 4.1.2.3 */
+        bool baseismin = hints->basew == hints->minw && hints->baseh == hints->minh;
+        if (!baseismin) { 
+            /* Temporarily remove base dimensions */
+            r->w -= hints->basew;
+            r->h -= hints->baseh;
+        }
+        /* Adjust for aspect limits */
+        if (hints->mina > 0 && hints->maxa > 0) {
+            if (hints->maxa < (float)r->w / r->h) {
+                r->w = r->h * hints->maxa + 0.5;
+            } else if (hints->mina < (float)r->h / r->w) {
+                r->h = r->w * hints->mina + 0.5;
+            }
+        }
+        if (baseismin) { 
+            /* Increment calculation requires this */
+            r->w -= hints->basew;
+            r->h -= hints->baseh;
+        }
+        /* Adjust for increment value */
+        if (hints->incw) {
+            r->w -= r->w % hints->incw;
+        }
+        if (hints->inch) {
+            r->h -= r->h % hints->inch;
+        }
+        /* Restore base dimensions */
+        r->w = MAX(r->w + hints->basew, hints->minw);
+        r->h = MAX(r->h + hints->baseh, hints->minh);
+        if (hints->maxw) {
+            r->w = MIN(r->w, hints->maxw);
+        }
+        if (hints->maxh) {
+            r->h = MIN(r->h, hints->maxh);
+        }
+    }
+    return r->x != cur->x || r->y != cur->y || r->w != cur->w || r->h != cur->h;
+}
+
+void layout_bar_pos(Rect mon, int bh, bool top_bar, Rect *win_area, int *bar_y)
+{
+    *win_area = mon;
+    win_area->h -= bh;
+    *bar_y = top_bar ? mon.y : mon.y + win_area->h;
+    win_area->y = top_bar ? mon.y + bh : mon.y;
+}
+
+void layout_tile(const LayoutParams *p, unsigned int n, LayoutSlot *slots)
+{
+    unsigned int i, h, mw, my, ty;
+    const Rect area = p->area;
+    const int bw = p->bw;
+
+    if (n == 0) {
+        return;
+    }
+    if (n > p->nmaster) {
+        mw = p->nmaster ? area.w * p->master_factor : 0;
+    } else {
+        mw = area.w;
+    }
+    for (i = my = ty = 0; i < n; i++) {
+        Rect *s = &slots[i].geom;
+        slots[i].configure = true;
+        if (i < p->nmaster) {
+            h = (area.h - my) / (MIN(n, p->nmaster) - i);
+            *s = (Rect){ area.x, area.y + my, mw - 2 * bw, h - 2 * bw };
+        } else {
+            h = (area.h - ty) / (n - i);
+            *s = (Rect){ area.x + mw, area.y + ty, area.w - mw - 2 * bw, h - 2 * bw };
+        }
+        /* The window ends up with the constrained height, stack below that */
+        Rect got = *s;
+        layout_apply_size_hints(&got, s, bw, area, false, p->min_size, NULL);
+        if (i < p->nmaster) {
+            if (my + got.h + 2 * bw < (unsigned int)area.h) my += got.h + 2 * bw;
+        } else {
+            if (ty + got.h + 2 * bw < (unsigned int)area.h) ty += got.h + 2 * bw;
+        }
+    }
+}
+
+void layout_monocle(const LayoutParams *p, unsigned int n, LayoutSlot *slots)
+{
+    for (unsigned int i = 0; i < n; i++) {
+        slots[i].configure = i == p->selected;
+        slots[i].geom = (Rect){ p->area.x, p->area.y, p->area.w - 2 * p->bw, p->area.h - 2 * p->bw };
+    }
+}
+
+void layout_grid(const LayoutParams *p, unsigned int n, LayoutSlot *slots)
+{
+    unsigned int cols, rows, cn = 0, rn = 0;
+    const Rect area = p->area;
+
+    if (n == 0) {
+        return;
+    }
+    /* Smallest square that holds every client */
+    for (cols = 1; cols * cols < n; cols++);
+    rows = n / cols;
+    int cw = area.w / cols;
+    for (unsigned int i = 0; i < n; i++) {
+        if (i / rows + 1 > cols - n % cols) {
+            rows = n / cols + 1;
+        }
+        int ch = area.h / rows;
+        slots[i].configure = true;
+        slots[i].geom = (Rect){ area.x + cn * cw, area.y + rn * ch, cw - 2 * p->bw, ch - 2 * p->bw };
+        if (++rn >= rows) {
+            rn = 0;
+            cn++;
+        }
+    }
+}
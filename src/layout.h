@@ -0,0 +1,59 @@
+#ifndef NDWM_LAYOUT_H
+#define NDWM_LAYOUT_H
+
+#include <stdbool.h>
+
+/* Pure layout core: geometry in, geometry out. Nothing in here talks to the
+ * X server or reads ndwm globals, so it can be benchmarked on its own. */
+
+typedef struct {
+    int x, y, w, h;
+} Rect;
+
+/* ICCCM size hints, only applied to floating clients */
+typedef struct {
+    float mina, maxa;
+    int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+} SizeHints;
+
+/* Constrains r, the requested inner geometry of a window with border bw
+ * currently at cur, to bounds and to at least min_size on each side. hints
+ * may be NULL. Interactive moves and resizes only have to stay on screen,
+ * so bounds is then the whole screen. Returns whether r differs from cur. */
+bool layout_apply_size_hints(Rect *r, const Rect *cur, int bw, Rect bounds, bool interact,
+                             int min_size, const SizeHints *hints);
+
+/* Splits the monitor area mon into the window area and the bar row */
+void layout_bar_pos(Rect mon, int bh, bool top_bar, Rect *win_area, int *bar_y);
+
+/* Inputs shared by every layout */
+typedef struct {
+    Rect area;             /* Window area of the monitor */
+    float master_factor;
+    unsigned int nmaster;  /* Clients in the master area */
+    unsigned int selected; /* Index of the client to show on top, n if none */
+    int bw, min_size;      /* Border of the tiled windows and smallest side */
+} LayoutParams;
+
+typedef struct {
+    Rect geom;      /* Inner geometry the window should request */
+    bool configure; /* False for clients the layout leaves untouched */
+} LayoutSlot;
+
+/* Fills slots[0..n) for n tiled clients */
+typedef void (*LayoutFunc)(const LayoutParams *p, unsigned int n, LayoutSlot *slots);
+
+typedef struct {
+    const char *symbol;
+    LayoutFunc arrange;
+    bool follows_focus; /* Has to be rearranged whenever focus changes */
+} Layout;
+
+/* nmaster clients in a column on the left, the rest stacked on the right */
+void layout_tile(const LayoutParams *p, unsigned int n, LayoutSlot *slots);
+/* Only the selected client, over the whole area */
+void layout_monocle(const LayoutParams *p, unsigned int n, LayoutSlot *slots);
+/* Columns of equal width, the rightmost ones take the extra rows */
+void layout_grid(const LayoutParams *p, unsigned int n, LayoutSlot *slots);
+
+#endif
@@ -0,0 +1,235 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include "loop.h"
+#include "utils.h"
+
+#define LOOP_MAX_EVENTS 16
+#define LOOP_MAX_TIMERS 32
+
+typedef struct LoopWatch LoopWatch;
+
+struct LoopWatch {
+    int fd;
+    LoopFdFunc func;
+    void *data;
+    LoopWatch *next;
+};
+
+typedef struct {
+    struct timespec deadline;
+    LoopTimerFunc func;
+    void *data;
+} LoopTimer;
+
+static int epoll_fd = -1;
+static LoopWatch *watches = NULL;
+static LoopWatch *unwatched = NULL; /* Freed once the current epoll batch has run */
+
+static int timer_fd = -1;
+static LoopTimer timers[LOOP_MAX_TIMERS];
+static unsigned int timer_count = 0;
+
+static int signal_fd = -1;
+static sigset_t signal_mask;
+static LoopSignalFunc signal_funcs[NSIG];
+
+static int timespec_cmp(const struct timespec *a, const struct timespec *b)
+{
+    if (a->tv_sec != b->tv_sec) {
+        return a->tv_sec < b->tv_sec ? -1 : 1;
+    }
+    return a->tv_nsec < b->tv_nsec ? -1 : a->tv_nsec > b->tv_nsec;
+}
+
+static void epoll_add(int fd, void *ptr)
+{
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = ptr };
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        die("ndwm: epoll_ctl:");
+    }
+}
+
+/* Arms the timerfd for the earliest pending deadline, or disarms it */
+static void timers_rearm(void)
+{
+    struct itimerspec its = { 0 };
+
+    for (unsigned int i = 0; i < timer_count; i++) {
+        if (i == 0 || timespec_cmp(&timers[i].deadline, &its.it_value) < 0) {
+            its.it_value = timers[i].deadline;
+        }
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void timers_run(void)
+{
+    uint64_t expirations;
+    struct timespec now;
+
+    if (read(timer_fd, &expirations, sizeof expirations) < 0 && errno != EAGAIN) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (unsigned int i = 0; i < timer_count;) {
+        if (timespec_cmp(&timers[i].deadline, &now) <= 0) {
+            LoopTimer expired = timers[i];
+            timers[i] = timers[--timer_count];
+            expired.func(expired.data);
+        } else {
+            i++;
+        }
+    }
+    timers_rearm();
+}
+
+static void unwatched_free(void)
+{
+    while (unwatched) {
+        LoopWatch *next = unwatched->next;
+        free(unwatched);
+        unwatched = next;
+    }
+}
+
+static void signals_run(void)
+{
+    struct signalfd_siginfo si;
+
+    while (read(signal_fd, &si, sizeof si) == sizeof si) {
+        if (si.ssi_signo < NSIG && signal_funcs[si.ssi_signo]) {
+            signal_funcs[si.ssi_signo](si.ssi_signo);
+        }
+    }
+}
+
+void loop_init(void)
+{
+    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        die("ndwm: epoll_create1:");
+    }
+    if ((timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        die("ndwm: timerfd_create:");
+    }
+    sigemptyset(&signal_mask);
+    if ((signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+        die("ndwm: signalfd:");
+    }
+    epoll_add(timer_fd, &timer_fd);
+    epoll_add(signal_fd, &signal_fd);
+}
+
+void loop_deinit(void)
+{
+    while (watches) {
+        loop_unwatch_fd(watches->fd);
+    }
+    unwatched_free();
+    sigprocmask(SIG_UNBLOCK, &signal_mask, NULL);
+    close(signal_fd);
+    close(timer_fd);
+    close(epoll_fd);
+    timer_count = 0;
+}
+
+void loop_watch_fd(int fd, LoopFdFunc func, void *data)
+{
+    LoopWatch *watch = ecalloc(1, sizeof(LoopWatch));
+
+    watch->fd = fd;
+    watch->func = func;
+    watch->data = data;
+    watch->next = watches;
+    watches = watch;
+    epoll_add(fd, watch);
+}
+
+void loop_unwatch_fd(int fd)
+{
+    LoopWatch **watch = &watches;
+
+    for (; *watch && (*watch)->fd != fd; watch = &(*watch)->next);
+    if (*watch) {
+        LoopWatch *found = *watch;
+        *watch = found->next;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        /* Events of the batch being dispatched may still point at it */
+        found->func = NULL;
+        found->next = unwatched;
+        unwatched = found;
+    }
+}
+
+void loop_add_timer(unsigned int msec, LoopTimerFunc func, void *data)
+{
+    if (timer_count == LOOP_MAX_TIMERS) {
+        die("ndwm: too many pending timers");
+    }
+    LoopTimer *timer = &timers[timer_count++];
+    clock_gettime(CLOCK_MONOTONIC, &timer->deadline);
+    timer->deadline.tv_sec += msec / 1000;
+    timer->deadline.tv_nsec += (long)(msec % 1000) * 1000000;
+    if (timer->deadline.tv_nsec >= 1000000000) {
+        timer->deadline.tv_sec++;
+        timer->deadline.tv_nsec -= 1000000000;
+    }
+    timer->func = func;
+    timer->data = data;
+    timers_rearm();
+}
+
+void loop_cancel_timer(LoopTimerFunc func, void *data)
+{
+    for (unsigned int i = 0; i < timer_count;) {
+        if (timers[i].func == func && timers[i].data == data) {
+            timers[i] = timers[--timer_count];
+        } else {
+            i++;
+        }
+    }
+    timers_rearm();
+}
+
+void loop_handle_signal(int signo, LoopSignalFunc func)
+{
+    signal_funcs[signo] = func;
+    sigaddset(&signal_mask, signo);
+    sigprocmask(SIG_BLOCK, &signal_mask, NULL);
+    signalfd(signal_fd, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+void loop_dispatch(void)
+{
+    struct epoll_event events[LOOP_MAX_EVENTS];
+    int n = epoll_wait(epoll_fd, events, LOOP_MAX_EVENTS, -1);
+
+    if (n < 0) {
+        if (errno != EINTR) {
+            die("ndwm: epoll_wait:");
+        }
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        void *source = events[i].data.ptr;
+        if (source == &timer_fd) {
+            timers_run();
+        } else if (source == &signal_fd) {
+            signals_run();
+        } else {
+            LoopWatch *watch = source;
+            if (watch->func) {
+                watch->func(watch->fd, watch->data);
+            }
+        }
+    }
+    unwatched_free();
+}
@@ -0,0 +1,29 @@
+#ifndef NDWM_LOOP_H
+#define NDWM_LOOP_H
+
+/* epoll based main loop: arbitrary descriptors, one-shot timers (timerfd)
+ * and signals (signalfd) are all waited on together. */
+typedef void (*LoopFdFunc)(int fd, void *data);
+typedef void (*LoopTimerFunc)(void *data);
+typedef void (*LoopSignalFunc)(int signo);
+
+void loop_init(void);
+void loop_deinit(void);
+
+/* Descriptor sources, the callback runs whenever fd is readable. Callbacks
+ * may watch and unwatch any descriptor, an unwatched one gets no further
+ * callbacks even if it was ready in the same batch. */
+void loop_watch_fd(int fd, LoopFdFunc func, void *data);
+void loop_unwatch_fd(int fd);
+
+/* One-shot timer, fires msec milliseconds from now */
+void loop_add_timer(unsigned int msec, LoopTimerFunc func, void *data);
+void loop_cancel_timer(LoopTimerFunc func, void *data);
+
+/* Blocks signo for the process and delivers it through the loop instead */
+void loop_handle_signal(int signo, LoopSignalFunc func);
+
+/* Waits until at least one source is ready and runs its callbacks */
+void loop_dispatch(void);
+
+#endif
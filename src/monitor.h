@@ -6,31 +6,87 @@
 
 typedef struct Monitor Monitor;
 
-/* Constants */
-static const char *tags[] = { "1", "2", "3", "4", "5", "6", "7", "8", "9" };
-#define TAGS_LEN 9
-
 typedef struct Pertag Pertag;
 
+/* Horizontal extent of a bar segment */
+typedef struct {
+    int x, w;
+} BarSpan;
+
+/* What each bar segment was last drawn with. draw_bar() repaints and
+ * copies a segment only when these differ from the current state. */
+typedef struct {
+    Pixmap buf;               /* Bar-sized back buffer, copied to the bar window */
+    int buf_w, buf_h;
+    bool valid;               /* Cleared when buf loses its contents */
+    int tray_w;               /* Systray gap left at the right end */
+    struct {
+        BarSpan span;
+        Tagset shown, occupied, urgent, selected, focused;
+    } tags;
+    struct {
+        BarSpan span;
+        const char *symbol;
+    } layout;
+    struct {
+        BarSpan span;
+        const Client *client;
+        char name[256];
+        bool floating, fixed;
+    } title;
+    struct {
+        BarSpan span;
+        char text[256];
+    } status;
+} Bar;
+
+/* Work deferred to the end of an event batch */
+enum {
+    DirtyArrange = 1 << 0,
+    DirtyRestack = 1 << 1,
+    DirtyBar     = 1 << 2,
+    DirtySystray = 1 << 3,
+};
+
 struct Monitor {
     float master_factor;
+    unsigned int nmaster;
+    const Layout *layout;
     int mx, my, mw, mh;   /* Screen size */
     int wx, wy, ww, wh;   /* Window area  */
     
     unsigned int seltags;
-    unsigned int tagset[2];
+    Tagset tagset[2];
     bool top_bar;
     Client *clients;
     Client *selected_client;
     Client *stack;
     Window bar_win;
     int by, bh;               /* Bar geometry */
+    Bar bar;
+    unsigned int dirty;       /* Dirty* flags, applied by flush_monitor */
+    Client **stack_order;     /* Stacking last applied by restack, top first, NULL for the systray and bar */
+    Client **stack_scratch;
+    Window *stack_wins;       /* Windows of the stacking restack sends */
+    unsigned int stack_len, stack_cap;
+    Client **tiled;           /* Visible tiled clients in list order, built before each layout */
+    LayoutSlot *slots;        /* What the layout computed for each of tiled */
+    Client *layout_top;       /* Client a follows_focus layout shows, restacked first */
+    unsigned int tiled_len, tiled_cap;
     Pertag *pertag;
 };
 
+/* Settings of one tag */
+typedef struct {
+    float master_factor;
+    unsigned int nmaster;
+    const Layout *layout;
+    Client *selected;     /* Focused client when the tag was left */
+} TagState;
+
 struct Pertag {
     unsigned int current_tag, previous_tag; /* Current and previous tag */
-    float master_factors[TAGS_LEN + 1]; /* master_factors per tag */
+    TagState *tags; /* One per configured tag, index 0 is the view of all tags */
 };
 
 #endif
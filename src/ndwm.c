@@ -12,11 +12,14 @@
 #include <X11/keysym.h>
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
 #include <X11/Xproto.h>
 #include <X11/Xutil.h>
 #include <X11/Xft/Xft.h>
 
+#include "arrange.h"
 #include "drw.h"
+#include "loop.h"
 #include "utils.h"
 #include "types/arg.h"
 #include "types/button.h"
@@ -24,15 +27,18 @@
 #include "types/client.h"
 #include "systray.h"
 #include "monitor.h"
+#include "slab.h"
+#include "winmap.h"
 #include "xerror.h"
 
 /* MACROS */
 #define BUTTONMASK                  (ButtonPressMask|ButtonReleaseMask)
 #define CLEANMASK(mask)             (mask & ~(numlockmask|LockMask) & (ShiftMask|ControlMask|Mod1Mask|Mod2Mask|Mod3Mask|Mod4Mask|Mod5Mask))
 #define MOUSEMASK                   (BUTTONMASK|PointerMotionMask)
-#define WIDTH(X)                    ((X)->w + 2 * (X)->bw)
-#define HEIGHT(X)                   ((X)->h + 2 * (X)->bw)
-#define TAGMASK                     ((1 << TAGS_LEN) - 1)
+#define TAGS_LEN                    LENGTH(tags)
+#define TAGBIT(I)                   ((Tagset)1 << (I))
+#define TAGS_MAX                    (8 * sizeof(Tagset))
+#define TAGMASK                     (~(Tagset)0 >> (TAGS_MAX - TAGS_LEN))
 #define TEXTW(X)                    (drw_fontset_getwidth(drw, (X)) + lrpad)
 #define ISVISIBLE(C)                ((C->tags & first_monitor->tagset[first_monitor->seltags]))
 #define SYSTEM_TRAY_REQUEST_DOCK    0
@@ -53,33 +59,61 @@ enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
        NetWMFullscreen, NetActiveWindow, NetWMWindowType,
        NetWMWindowTypeDialog, NetClientList, NetLast }; /* EWMH atoms */
 enum { Manager, Xembed, XembedInfo, XLast }; /* Xembed atoms */
-enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* Default atoms */
+enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMSyncRequest, WMPing, WMLast }; /* Default atoms */
 enum { ClkTagBar, ClkClientWin, ClkRootWin }; /* Clicks */
+enum { PropNetWMName, PropWMName, PropTransientFor, PropNetWMState,
+       PropWindowType, PropNormalHints, PropWMHints, PropProtocols, PropLast }; /* Client properties */
+
+#define PROP(P)                     (1u << (P))
+#define PROP_ALL                    (PROP(PropLast) - 1)
+
+/* Property replies of one window, requested together by request_props */
+typedef struct {
+    unsigned int mask;
+    xcb_get_property_cookie_t cookie[PropLast];
+    xcb_get_property_reply_t *reply[PropLast];
+} ClientProps;
+
+#define CLIENT_CHUNK                64
 
 
 /* Init and deinit functions, following the Zig memory management pattern. */
 static Systray *systray_init(Monitor *m, XSetWindowAttributes *window_attrs);
 static Monitor *monitor_init(void);
 static Client *client_init(void);
+static void client_free(Client *c);
 static void monitor_deinit(Display *dpy, Monitor *m);
 static void systray_deinit(Display *display, Systray *systray);
 
 static void arrange(Monitor *m);
 static void configure(Display *dpy, Client *c);
 static void draw_bar(Monitor *m);
+static Tagset bar_tags(const Monitor *m, Tagset *urgent, Tagset *occupied);
+static bool bar_span_moved(BarSpan a, BarSpan b);
+static void flush_monitor(Monitor *m);
 static Client *next_tiled_client(Client *c);
 static void restack(Monitor *m);
 static void scan(void);
 static bool send_event(Window w, Atom proto, int m, long d0, long d1, long d2, long d3, long d4);
-static void showhide(Client *c);
 static Client *window_to_client(Window w);
 static void make_master(const Arg *arg);
 static void move_client_next(const Arg *arg);
 static void rotate_clients(const Arg *arg);
 
+/* Server state mirror, each drops requests that would change nothing */
+static void client_set_border(Client *c, unsigned long pixel);
+static void client_map(Client *c, bool raise);
+static void client_raise(Client *c);
+static void dump_stats(int signo);
+
 /* Setup function */
 static void setup(void);
 
+/* Main loop */
+static void run(void);
+static void x_readable(int fd, void *data);
+static void terminate(int signo);
+
 /* Other systray-related functions */
 static void remove_systray_icon(Systray *systray, Client *c);
 static unsigned int get_systray_width(Systray *systray);
@@ -89,6 +123,7 @@ static Client *window_to_systray_icon(Systray *systray, Window w);
 static void focus(Display *dpy, Monitor *mon, Window root, Client *c);
 static void unfocus(Client *c, bool set_focus);
 static void manage(Window w, const XWindowAttributes *wa);
+static void adopt(Window w, const XWindowAttributes *wa, const ClientProps *props);
 static void unmanage(Client *c, bool destroyed);
 
 /* Grab functions */
@@ -96,15 +131,27 @@ static void grab_buttons(Client *c, bool focused);
 static void grab_keys(void);
 
 /* Apply functions */
-static void apply_rules(Display *dpy, Monitor *mon, Client *c);
+static void apply_rules(Monitor *mon, Client *c);
 static bool apply_size_hints(const Monitor *mon, Client *c, int *x, int *y, int *w, int *h, bool interact);
 
 /* Get functions */
 static int get_root_ptr(int *x, int *y);
-static long get_state(Window w);
 static Atom get_atom_prop(Client *c, Atom prop);
 static bool get_text_prop(Window w, Atom atom, char *text, unsigned int size);
 
+/* Pipelined property functions */
+static void fetch_props(Window w, unsigned int mask, ClientProps *props);
+static void request_props(Window w, unsigned int mask, ClientProps *props);
+static void collect_props(ClientProps *props);
+static void free_props(ClientProps *props);
+static unsigned int props_for_atom(Atom atom);
+static const uint32_t *prop_items(const xcb_get_property_reply_t *reply, int *n);
+static uint32_t prop_first(const xcb_get_property_reply_t *reply, xcb_atom_t type);
+static Window prop_window(const xcb_get_property_reply_t *reply);
+static Atom prop_atom(const xcb_get_property_reply_t *reply);
+static bool prop_text(const xcb_get_property_reply_t *reply, char *text, unsigned int size);
+static bool text_prop_to_string(XTextProperty *name, char *text, unsigned int size);
+
 /* Set functions */
 static void set_focus(Display *dpy, Client *c);
 static void set_urgent(Client *c, bool urg);
@@ -112,9 +159,8 @@ static void set_client_state(Client *c, long state);
 static void set_fullscreen(Display *dpy, Monitor *mon, Client *c, bool fullscreen);
 
 /* Resize functions */
-static void resize(Client *c, int x, int y, int w, int h, bool interact);
 static void resize_bar_win(Display *display, Monitor *m, Systray *systray);
-static void resize_client(Display *dpy, Monitor *mon, Client *c, int x, int y, int w, int h);
+static void resize_client(Display *dpy, Client *c, int x, int y, int w, int h, bool sole);
 
 /* Cleanup functions */
 static void cleanup(void);
@@ -127,17 +173,19 @@ static void detach_stack(Monitor *mon, Client *c);
 
 /* Update functons */
 static void update_bar(Display *dpy, Window root, Monitor *mon);
+static void update_bar_buffer(Monitor *m);
 static void update_client_list(void);
 static bool update_geometry(void);
 static void update_numlock_mask(unsigned int *numlockmask);
-static void update_size_hints(Client *c);
+static void update_protocols(Client *c, const ClientProps *props);
+static void update_size_hints(Client *c, const ClientProps *props);
 static void update_status(void);
 static void update_systray(Display *dpy, Monitor *m);
 static void update_systray_icon_geometry(const Monitor *mon, Client *client, int w, int h);
 static void update_systray_icon_state(Client *i, const XPropertyEvent *ev);
-static void update_title(Client *c);
-static void update_window_type(Client *c);
-static void update_wm_hints(Display *dpy, const Monitor *mon, Client *c);
+static void update_title(Client *c, const ClientProps *props);
+static void update_window_type(Client *c, const ClientProps *props);
+static void update_wm_hints(Display *dpy, const Monitor *mon, Client *c, const ClientProps *props);
 static void update_bar_pos(Monitor *m);
 
 /* Key commands */
@@ -155,6 +203,8 @@ static void move_client_to_left_tag(const Arg *arg);
 static void destroy_client(const Arg *arg);
 static void resize_with_mouse(const Arg *arg);
 static void increase_master_width(const Arg *arg);
+static void increase_nmaster(const Arg *arg);
+static void set_layout(const Arg *arg);
 static void decrease_master_width(const Arg *arg);
 static void tag(const Arg *arg);
 static void move_with_mouse(const Arg *arg);
@@ -166,6 +216,7 @@ static void configure_request(XEvent *e);
 static void configure_notify(XEvent *e);
 static void destroy_notify(XEvent *e);
 static void enter_notify(XEvent *e);
+static void ignore_enters_since(unsigned long first_request);
 static void expose(XEvent *e);
 static void focus_in(XEvent *e);
 static void key_press(XEvent *e);
@@ -180,9 +231,6 @@ static void unmap_notify(XEvent *e);
 static void check_another_wm_running(Display *dpy);
 static int xerror(Display *dpy, XErrorEvent *ee);
 
-/* Tile function */
-static void tile(Monitor *m);
-
 /* Handler */
 static void (*handler[LASTEvent]) (XEvent *) = {
     [ButtonPress] = button_press,
@@ -216,14 +264,34 @@ static bool running = true;
 static Cur *cursor[CurLast];
 static Clr **scheme;
 static Display *dpy;
+static xcb_connection_t *xcb; /* Same connection as dpy, used for pipelined requests */
 static Drw *drw;
 static Window root, wmcheckwin;
 static Systray *systray = NULL;
 static Monitor *first_monitor = NULL;
+static unsigned long enter_ignore_first, enter_ignore_last; /* Serials of our own layout requests */
+static unsigned long suppressed_requests = 0; /* Requests the server mirror found redundant */
+static unsigned long bar_segments_drawn = 0;  /* Bar segments repainted by draw_bar */
+static WinMap client_index;       /* Managed clients by window */
+static WinMap systray_icon_index; /* Docked systray icons by window */
+static Slab client_slab = SLAB_INIT(Client, CLIENT_CHUNK);      /* Managed clients and systray icons */
+static Slab client_cold_slab = SLAB_INIT(ClientCold, CLIENT_CHUNK);
+
+/* Fails to compile when Client outgrows the cache line the slab gives it */
+typedef char client_fits_line[sizeof(Client) <= SLAB_LINE ? 1 : -1];
 
 /* Configuration, allows nested code to access above variables */
 #include "config.h"
 
+/* What arrange.c needs of it */
+const ArrangeConfig arrange_config = { borderpx, master_factor, hide_by_unmap };
+
+/* Fails to compile when config.h lists no tags or more than a Tagset holds,
+ * TAGMASK and TAGBIT would shift out of range without a diagnostic */
+typedef char tags_fit_in_tagset[LENGTH(tags) >= 1 && LENGTH(tags) <= TAGS_MAX ? 1 : -1];
+
+static int tag_width[LENGTH(tags)]; /* TEXTW of each tag name, measured once in setup */
+
 Systray *systray_init(Monitor *m, XSetWindowAttributes *window_attrs)
 {
     Systray *new_systray = ecalloc(1, sizeof(Systray));
@@ -268,7 +336,11 @@ void move_client_next(const Arg *arg)
 
     if (c) {
         detach(first_monitor, selected_client);
+        selected_client->cold->prev = c;
         selected_client->next = c->next;
+        if (c->next) {
+            c->next->cold->prev = selected_client;
+        }
         c->next = selected_client;
     } else {
         detach(first_monitor, selected_client);
@@ -290,18 +362,23 @@ void button_press(XEvent *e)
     unfocus(first_monitor->selected_client, true);
     focus(dpy, first_monitor, root, NULL);
     if (ev->window == first_monitor->bar_win) {
-        unsigned int x = 0;
-        i = x;
-        do {
-            x += TEXTW(tags[i]);
-        } while (ev->x >= x && ++i < TAGS_LEN);
-        if (i < TAGS_LEN) {
-            click = ClkTagBar;
-            arg.ui = 1 << i;
-        } 
+        /* Same tags as draw_bar, the others take no space */
+        Tagset shown = bar_tags(first_monitor, NULL, NULL);
+        int x = 0;
+        for (i = 0; i < TAGS_LEN; i++) {
+            if (!(shown & TAGBIT(i))) {
+                continue;
+            }
+            x += tag_width[i];
+            if (ev->x < x) {
+                click = ClkTagBar;
+                arg.tags = TAGBIT(i);
+                break;
+            }
+        }
     } else if (client) {
         focus(dpy, first_monitor, root, client);
-        restack(first_monitor);
+        first_monitor->dirty |= DirtyRestack;
         XAllowEvents(dpy, ReplayPointer, CurrentTime);
         click = ClkClientWin;
     }
@@ -315,44 +392,46 @@ void button_press(XEvent *e)
 
 void attach_stack(Monitor *mon, Client *c)
 {
+    c->stack_prev = NULL;
     c->stack_next = mon->stack;
+    if (mon->stack) {
+        mon->stack->stack_prev = c;
+    }
     mon->stack = c;
 }
 
 void attach(Monitor *mon, Client *c)
 {
+    c->cold->prev = NULL;
     c->next = mon->clients;
+    if (mon->clients) {
+        mon->clients->cold->prev = c;
+    }
     mon->clients = c;
 }
 
 Client *window_to_systray_icon(Systray *systray, Window w) 
 {
-    Client *client = systray->icons;
-
     if (!w) { 
-        return client;
+        return systray->icons;
     }
-    for (; client && client->win != w; client = client->next);
-    return client;
+    return winmap_lookup(&systray_icon_index, w);
 }
 
 Client *window_to_client(Window w)
 {
-    for (Client *client = first_monitor->clients; client; client = client->next) {
-        if (client->win == w) {
-            return client;
-        }
-    }
-    return NULL;
+    return winmap_lookup(&client_index, w);
 }
 
 void update_bar_pos(Monitor *m)
 {
-    m->wy = m->my;
-    m->wh = m->mh;
-    m->wh -= m->bh;
-    m->by = m->top_bar ? m->wy : m->wy + m->wh;
-    m->wy = m->top_bar ? m->wy + m->bh : m->wy;
+    Rect win_area;
+
+    layout_bar_pos((Rect){ m->mx, m->my, m->mw, m->mh }, m->bh, m->top_bar, &win_area, &m->by);
+    m->wx = win_area.x;
+    m->wy = win_area.y;
+    m->ww = win_area.w;
+    m->wh = win_area.h;
 }
 
 void remove_systray_icon(Systray *systray, Client *c)
@@ -361,7 +440,8 @@ void remove_systray_icon(Systray *systray, Client *c)
 
     for (; *icon && *icon != c; icon = &(*icon)->next);
     *icon = c->next;
-    free(c);
+    winmap_remove(&systray_icon_index, c->cold->win);
+    client_free(c);
 }
 
 unsigned int get_systray_width(Systray *systray)
@@ -371,106 +451,32 @@ unsigned int get_systray_width(Systray *systray)
     return (systray_width != 0) ? systray_width + systrayspacing : 1;
 }
 
-void apply_rules(Display *dpy, Monitor *mon, Client *c)
+void apply_rules(Monitor *mon, Client *c)
 {
-    XClassHint class_hint = { NULL, NULL };
-
     /* Rule matching */
     c->is_floating = false;
-    XGetClassHint(dpy, c->win, &class_hint);
-    if (class_hint.res_class) {
-        XFree(class_hint.res_class);
-    }
-    if (class_hint.res_name) {
-        XFree(class_hint.res_name);
-    }
     c->tags = (c->tags & TAGMASK) ? c->tags & TAGMASK : mon->tagset[mon->seltags];
 }
 
 bool apply_size_hints(const Monitor *mon, Client *c, int *x, int *y, int *w, int *h, bool interact)
 {
-    /* Set minimum possible */
-    *w = MAX(1, *w);
-    *h = MAX(1, *h);
-    if (interact) {
-        if (*x > screen_width) {
-            *x = screen_width - WIDTH(c);
-        }
-        if (*y > sh) {
-            *y = sh - HEIGHT(c);
-        }
-        if (*x + *w + 2 * c->bw < 0) {
-            *x = 0;
-        }
-        if (*y + *h + 2 * c->bw < 0) {
-            *y = 0;
-        }
-    } else {
-        if (*x >= mon->wx + mon->ww) {
-            *x = mon->wx + mon->ww - WIDTH(c);
-        }
-        if (*y >= mon->wy + mon->wh) {
-            *y = mon->wy + mon->wh - HEIGHT(c);
-        }
-        if (*x + *w + 2 * c->bw <= mon->wx) {
-            *x = mon->wx;
-        }
-        if (*y + *h + 2 * c->bw <= mon->wy) {
-            *y = mon->wy;
-        }
-    }
-    if (*h < mon->bh) {
-        *h = mon->bh;
-    }
-    if (*w < mon->bh) {
-        *w = mon->bh;
-    }
-    if (c->is_floating) {
-        /* See last two sentences in ICCCM 4.1.2.3 */
-        bool baseismin = c->basew == c->minw && c->baseh == c->minh;
-        if (!baseismin) { 
-            /* Temporarily remove base dimensions */
-            *w -= c->basew;
-            *h -= c->baseh;
-        }
-        /* Adjust for aspect limits */
-        if (c->mina > 0 && c->maxa > 0) {
-            if (c->maxa < (float)*w / *h) {
-                *w = *h * c->maxa + 0.5;
-            } else if (c->mina < (float)*h / *w) {
-                *h = *w * c->mina + 0.5;
-            }
-        }
-        if (baseismin) { 
-            /* Increment calculation requires this */
-            *w -= c->basew;
-            *h -= c->baseh;
-        }
-        /* Adjust for increment value */
-        if (c->incw) {
-            *w -= *w % c->incw;
-        }
-        if (c->inch) {
-            *h -= *h % c->inch;
-        }
-        /* Restore base dimensions */
-        *w = MAX(*w + c->basew, c->minw);
-        *h = MAX(*h + c->baseh, c->minh);
-        if (c->maxw) {
-            *w = MIN(*w, c->maxw);
-        }
-        if (c->maxh) {
-            *h = MIN(*h, c->maxh);
-        }
-    }
-    return *x != c->x || *y != c->y || *w != c->w || *h != c->h;
+    Rect r = { *x, *y, *w, *h };
+    Rect cur = { c->x, c->y, c->w, c->h };
+    Rect bounds = interact ? (Rect){ 0, 0, screen_width, sh } : (Rect){ mon->wx, mon->wy, mon->ww, mon->wh };
+    bool changed = layout_apply_size_hints(&r, &cur, c->bw, bounds, interact, mon->bh,
+                                           c->is_floating ? &c->cold->hints : NULL);
+
+    *x = r.x;
+    *y = r.y;
+    *w = r.w;
+    *h = r.h;
+    return changed;
 }
 
+/* Layout is deferred to the end of the current event batch, see flush_monitor */
 void arrange(Monitor *m)
 {
-    showhide(m->stack);
-    tile(m);
-    restack(m);
+    m->dirty |= DirtyArrange;
 }
 
 void systray_deinit(Display *display, Systray *systray)
@@ -482,11 +488,15 @@ void systray_deinit(Display *display, Systray *systray)
 
 void cleanup(void)
 {
-    Arg a = {.ui = 0};
+    Arg a = {.tags = 0};
     size_t i;
 
     view(&a);
-    unmanage(first_monitor->stack, false);
+    /* unmanage maps hidden clients again, otherwise they would stay
+     * unmapped under the next window manager */
+    while (first_monitor->stack) {
+        unmanage(first_monitor->stack, false);
+    }
     XUngrabKey(dpy, AnyKey, AnyModifier, root);
     
     monitor_deinit(dpy, first_monitor);
@@ -500,24 +510,50 @@ void cleanup(void)
     }
     free(scheme);
     XDestroyWindow(dpy, wmcheckwin);
+    winmap_free(&client_index);
+    winmap_free(&systray_icon_index);
+    slab_deinit(&client_slab);
+    slab_deinit(&client_cold_slab);
     drw_free(drw);
     XSync(dpy, False);
     XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
     XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
+    loop_deinit();
 }
 
 void monitor_deinit(Display *dpy, Monitor *m)
 {
+    if (m->bar.buf) {
+        XFreePixmap(dpy, m->bar.buf);
+    }
     XUnmapWindow(dpy, m->bar_win);
     XDestroyWindow(dpy, m->bar_win);
+    free(m->stack_order);
+    free(m->stack_scratch);
+    free(m->stack_wins);
+    free(m->tiled);
+    free(m->slots);
+    free(m->pertag->tags);
+    free(m->pertag);
     free(m);
 }
 
+/* Client records come from slabs of CLIENT_CHUNK, so the hot records of
+ * neighbouring clients share pages, one cache line each, instead of being
+ * spread over the heap next to their 256 byte titles. Short-lived windows
+ * reuse freed records rather than going back to malloc. */
 Client *client_init(void) {
-    Client *new_client = (Client *)ecalloc(1, sizeof(Client));
+    Client *new_client = slab_alloc(&client_slab);
+    new_client->cold = slab_alloc(&client_cold_slab);
     return new_client;
 }
 
+void client_free(Client *c)
+{
+    slab_free(&client_cold_slab, c->cold);
+    slab_free(&client_slab, c);
+}
+
 void client_message(XEvent *e)
 {
     XWindowAttributes wa;
@@ -529,42 +565,48 @@ void client_message(XEvent *e)
         /* Add systray icons */
         if (cme->data.l[1] == SYSTEM_TRAY_REQUEST_DOCK) {
             c = client_init();
-            if (!(c->win = cme->data.l[2])) {
-                free(c);
+            if (!(c->cold->win = cme->data.l[2])) {
+                client_free(c);
                 return;
             }
             c->next = systray->icons;
             systray->icons = c;
-            if (!XGetWindowAttributes(dpy, c->win, &wa)) {
+            winmap_insert(&systray_icon_index, c->cold->win, c);
+            if (!XGetWindowAttributes(dpy, c->cold->win, &wa)) {
                 /* Use sane defaults */
                 wa.width = first_monitor->bh;
                 wa.height = first_monitor->bh;
                 wa.border_width = 0;
             }
-            c->x = c->oldx = c->y = c->oldy = 0;
-            c->w = c->oldw = wa.width;
-            c->h = c->oldh = wa.height;
-            c->oldbw = wa.border_width;
+            c->x = c->cold->oldx = c->y = c->cold->oldy = 0;
+            c->w = c->cold->oldw = wa.width;
+            c->h = c->cold->oldh = wa.height;
+            c->cold->oldbw = c->server.bw = wa.border_width;
+            c->server.w = wa.width;
+            c->server.h = wa.height;
             c->bw = 0;
             c->is_floating = True;
             /* Reuse tags field as mapped status */
             c->tags = 1;
-            update_size_hints(c);
+            ClientProps props;
+            fetch_props(c->cold->win, PROP(PropNormalHints), &props);
+            update_size_hints(c, &props);
+            free_props(&props);
             update_systray_icon_geometry(first_monitor, c, wa.width, wa.height);
-            XAddToSaveSet(dpy, c->win);
-            XSelectInput(dpy, c->win, StructureNotifyMask | PropertyChangeMask | ResizeRedirectMask);
-            XReparentWindow(dpy, c->win, systray->win, 0, 0);
+            xerror_ignore_begin(dpy);
+            XAddToSaveSet(dpy, c->cold->win);
+            XSelectInput(dpy, c->cold->win, StructureNotifyMask | PropertyChangeMask | ResizeRedirectMask);
+            XReparentWindow(dpy, c->cold->win, systray->win, 0, 0);
             /* Use parents background color */
             swa.background_pixel  = scheme[SchemeNorm][ColBg].pixel;
-            XChangeWindowAttributes(dpy, c->win, CWBackPixel, &swa);
-            send_event(c->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_EMBEDDED_NOTIFY, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
+            XChangeWindowAttributes(dpy, c->cold->win, CWBackPixel, &swa);
+            send_event(c->cold->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_EMBEDDED_NOTIFY, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
             /* TODO: Do we need to send these events? */
-            send_event(c->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_FOCUS_IN, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
-            send_event(c->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_WINDOW_ACTIVATE, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
-            send_event(c->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_MODALITY_ON, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
-            XSync(dpy, False);
-            resize_bar_win(dpy, first_monitor, systray);
-            update_systray(dpy, first_monitor);
+            send_event(c->cold->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_FOCUS_IN, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
+            send_event(c->cold->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_WINDOW_ACTIVATE, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
+            send_event(c->cold->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_MODALITY_ON, 0 , systray->win, XEMBED_EMBEDDED_VERSION);
+            xerror_ignore_end(dpy);
+            first_monitor->dirty |= DirtySystray;
             set_client_state(c, NormalState);
         }
         return;
@@ -580,12 +622,12 @@ void client_message(XEvent *e)
         }
     } else if (cme->message_type == netatom[NetActiveWindow]) {
         unsigned int i = 0;
-        for (; i < TAGS_LEN && !((1 << i) & c->tags); i++);
+        for (; i < TAGS_LEN && !(TAGBIT(i) & c->tags); i++);
         if (i < TAGS_LEN) {
-            const Arg a = {.ui = 1 << i};
+            const Arg a = {.tags = TAGBIT(i)};
             view(&a);
             focus(dpy, first_monitor, root,  c);
-            restack(first_monitor);
+            first_monitor->dirty |= DirtyRestack;
         }
     }
 }
@@ -596,8 +638,8 @@ void configure(Display *dpy, Client *c)
 
     ce.type = ConfigureNotify;
     ce.display = dpy;
-    ce.event = c->win;
-    ce.window = c->win;
+    ce.event = c->cold->win;
+    ce.window = c->cold->win;
     ce.x = c->x;
     ce.y = c->y;
     ce.width = c->w;
@@ -605,7 +647,96 @@ void configure(Display *dpy, Client *c)
     ce.border_width = c->bw;
     ce.above = None;
     ce.override_redirect = False;
-    XSendEvent(dpy, c->win, False, StructureNotifyMask, (XEvent *)&ce);
+    XSendEvent(dpy, c->cold->win, False, StructureNotifyMask, (XEvent *)&ce);
+}
+
+bool client_configure(Client *c, int x, int y, int w, int h, int bw)
+{
+    XWindowChanges wc = { .x = x, .y = y, .width = w, .height = h, .border_width = bw };
+    unsigned int mask = (x != c->server.x ? CWX : 0) | (y != c->server.y ? CWY : 0)
+        | (w != c->server.w ? CWWidth : 0) | (h != c->server.h ? CWHeight : 0)
+        | (bw != c->server.bw ? CWBorderWidth : 0);
+
+    if (!mask) {
+        suppressed_requests++;
+        return false;
+    }
+    XConfigureWindow(dpy, c->cold->win, mask, &wc);
+    c->server.x = x;
+    c->server.y = y;
+    c->server.w = w;
+    c->server.h = h;
+    c->server.bw = bw;
+    return true;
+}
+
+void client_set_border(Client *c, unsigned long pixel)
+{
+    if (c->cold->server.border_known && c->cold->server.border == pixel) {
+        suppressed_requests++;
+        return;
+    }
+    XSetWindowBorder(dpy, c->cold->win, pixel);
+    c->cold->server.border = pixel;
+    c->cold->server.border_known = true;
+}
+
+void client_map(Client *c, bool raise)
+{
+    if (c->cold->server.mapped) {
+        suppressed_requests++;
+        return;
+    }
+    if (raise) {
+        XMapRaised(dpy, c->cold->win);
+    } else {
+        XMapWindow(dpy, c->cold->win);
+    }
+    c->cold->server.mapped = true;
+}
+
+/* Unmaps a client that is not shown. Its UnmapNotify arrives twice,
+ * for the window and for root, both carrying the serial of this request,
+ * see unmap_notify. Only a client on a hidden tag is iconic. One that a
+ * monocle layout covers on a shown tag keeps NormalState, so pagers and
+ * taskbars do not list it as minimized. */
+void client_hide(Client *c, bool iconic)
+{
+    if (!c->hidden) {
+        if (!c->cold->server.mapped) {
+            suppressed_requests++;
+            return;
+        }
+        c->cold->hide_serial = NextRequest(dpy);
+        XUnmapWindow(dpy, c->cold->win);
+        c->cold->server.mapped = false;
+        c->hidden = true;
+    }
+    if (c->cold->iconic != iconic) {
+        c->cold->iconic = iconic;
+        set_client_state(c, iconic ? IconicState : NormalState);
+    }
+}
+
+void client_show(Client *c)
+{
+    if (!c->hidden) {
+        suppressed_requests++;
+        return;
+    }
+    client_map(c, false);
+    c->hidden = false;
+    if (c->cold->iconic) {
+        c->cold->iconic = false;
+        set_client_state(c, NormalState);
+    }
+}
+
+/* Raising changes the stacking behind restack's back, make it redo it */
+void client_raise(Client *c)
+{
+    XRaiseWindow(dpy, c->cold->win);
+    first_monitor->stack_len = 0;
 }
 
 void configure_notify(XEvent *e)
@@ -618,11 +749,11 @@ void configure_notify(XEvent *e)
         screen_width = ev->width;
         sh = ev->height;
         if (update_geometry() || dirty) {
-            drw_resize(drw, screen_width, first_monitor->bh);
             update_bar(dpy, root, first_monitor);
+            update_bar_buffer(first_monitor);
             for (Client *client = first_monitor->clients; client; client = client->next) {
                 if (client->is_fullscreen) {
-                    resize_client(dpy, first_monitor, client, first_monitor->mx, first_monitor->my, first_monitor->mw, first_monitor->mh);
+                    resize_client(dpy, client, first_monitor->mx, first_monitor->my, first_monitor->mw, first_monitor->mh, false);
                 }
             }
             resize_bar_win(dpy, first_monitor, systray);
@@ -637,24 +768,28 @@ void configure_request(XEvent *e)
     XConfigureRequestEvent *ev = &e->xconfigurerequest;
     Client *c = window_to_client(ev->window);
 
+    /* The requesting window may already be gone */
+    xerror_ignore_begin(dpy);
     if (c) {
-        if (ev->value_mask & CWBorderWidth) {
+        if ((ev->value_mask & CWBorderWidth) && c->is_floating) {
+            /* Tiled clients keep borderpx, the layout slots are sized for it */
             c->bw = ev->border_width;
+            configure(dpy, c);
         } else if (c->is_floating) {
             if (ev->value_mask & CWX) {
-                c->oldx = c->x;
+                c->cold->oldx = c->x;
                 c->x = first_monitor->mx + ev->x;
             }
             if (ev->value_mask & CWY) {
-                c->oldy = c->y;
+                c->cold->oldy = c->y;
                 c->y = first_monitor->my + ev->y;
             }
             if (ev->value_mask & CWWidth) {
-                c->oldw = c->w;
+                c->cold->oldw = c->w;
                 c->w = ev->width;
             }
             if (ev->value_mask & CWHeight) {
-                c->oldh = c->h;
+                c->cold->oldh = c->h;
                 c->h = ev->height;
             }
             if ((c->x + c->w) > first_monitor->mx + first_monitor->mw && c->is_floating) {
@@ -663,11 +798,15 @@ void configure_request(XEvent *e)
             if ((c->y + c->h) > first_monitor->my + first_monitor->mh && c->is_floating) {
                 c->y = first_monitor->my + (first_monitor->mh / 2 - HEIGHT(c) / 2); /* Center in y direction */
             }
+            bool answered = false;
             if ((ev->value_mask & (CWX|CWY)) && !(ev->value_mask & (CWWidth|CWHeight))) {
                 configure(dpy, c);
+                answered = true;
             }
-            if (ISVISIBLE(c)) {
-                XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+            if (!(ISVISIBLE(c) && client_configure(c, c->x, c->y, c->w, c->h, c->server.bw)) && !answered) {
+                /* Nothing reached the server, so no real ConfigureNotify will
+                 * answer the request, ICCCM 4.1.5 wants one anyway */
+                configure(dpy, c);
             }
         } else {
             configure(dpy, c);
@@ -683,7 +822,7 @@ void configure_request(XEvent *e)
         wc.stack_mode = ev->detail;
         XConfigureWindow(dpy, ev->window, ev->value_mask, &wc);
     }
-    XSync(dpy, False);
+    xerror_ignore_end(dpy);
 }
 
 Monitor *monitor_init(void)
@@ -692,13 +831,18 @@ Monitor *monitor_init(void)
 
     new_monitor->tagset[0] = new_monitor->tagset[1] = 1;
     new_monitor->master_factor = master_factor;
+    new_monitor->nmaster = nmaster;
+    new_monitor->layout = &layouts[0];
     new_monitor->top_bar = top_bar;
     new_monitor->bh = drw->fonts->h + 2;
     new_monitor->pertag = ecalloc(1, sizeof(Pertag));
+    new_monitor->pertag->tags = ecalloc(TAGS_LEN + 1, sizeof(TagState));
     new_monitor->pertag->current_tag = new_monitor->pertag->previous_tag = 1;
 
     for (unsigned int i = 0; i <= TAGS_LEN; i++) {
-        new_monitor->pertag->master_factors[i] = new_monitor->master_factor;
+        new_monitor->pertag->tags[i].master_factor = new_monitor->master_factor;
+        new_monitor->pertag->tags[i].nmaster = new_monitor->nmaster;
+        new_monitor->pertag->tags[i].layout = new_monitor->layout;
     }
     return new_monitor;
 }
@@ -712,25 +856,36 @@ void destroy_notify(XEvent *e)
         unmanage(client, true);
     } else if ((client = window_to_systray_icon(systray, ev->window))) {
         remove_systray_icon(systray, client);
-        resize_bar_win(dpy, first_monitor, systray);
-        update_systray(dpy, first_monitor);
+        first_monitor->dirty |= DirtySystray;
     }
 }
 
 void detach(Monitor *mon, Client *c)
 {
-    Client **tc;
-
-    for (tc = &mon->clients; *tc && *tc != c; tc = &(*tc)->next);
-    *tc = c->next;
+    if (c->cold->prev) {
+        c->cold->prev->next = c->next;
+    } else {
+        mon->clients = c->next;
+    }
+    if (c->next) {
+        c->next->cold->prev = c->cold->prev;
+    }
+    c->next = c->cold->prev = NULL;
 }
 
 void detach_stack(Monitor *mon, Client *c)
 {
-    Client **tc, *t;
+    Client *t;
 
-    for (tc = &mon->stack; *tc && *tc != c; tc = &(*tc)->stack_next);
-    *tc = c->stack_next;
+    if (c->stack_prev) {
+        c->stack_prev->stack_next = c->stack_next;
+    } else {
+        mon->stack = c->stack_next;
+    }
+    if (c->stack_next) {
+        c->stack_next->stack_prev = c->stack_prev;
+    }
+    c->stack_next = c->stack_prev = NULL;
 
     if (c == mon->selected_client) {
         for (t = mon->stack; t && !ISVISIBLE(t); t = t->stack_next);
@@ -738,53 +893,182 @@ void detach_stack(Monitor *mon, Client *c)
     }
 }
 
+bool bar_span_moved(BarSpan a, BarSpan b)
+{
+    return a.x != b.x || a.w != b.w;
+}
+
+/* Redraws the bar segments whose inputs changed since they were last drawn:
+ * systray gap, status, tags, layout symbol and title */
 void draw_bar(Monitor *m)
 {
+    Bar *bar = &m->bar;
     int boxs = drw->fonts->h / 9;
     int boxw = drw->fonts->h / 6 + 2;
-    unsigned int occ = 0, urg = 0;
-
+    bool force = !bar->valid;
+    Tagset occ, urg;
+    Tagset shown = bar_tags(m, &urg, &occ);
+    Tagset focused = m->selected_client ? m->selected_client->tags : 0;
+    const Client *c = show_title ? m->selected_client : NULL;
+
+    drw_set_target(drw, bar->buf, bar->buf_w, bar->buf_h);
+    bar->valid = true;
     int stw = get_systray_width(systray);
-    /* Draw status first so it can be overdrawn by tags later */
-    drw->scheme = scheme[SchemeNorm];
-    int sw = TEXTW(stext) - lrpad / 2 + 2; /* 2px right padding */
-    drw_text(drw, m->ww - sw - stw, 0, sw, m->bh, lrpad / 2 - 2, stext, 0);
-
-    resize_bar_win(dpy, m, systray);
-    for (Client *client = m->clients; client; client = client->next) {
-        occ |= client->tags;
-        if (client->is_urgent) {
-            urg |= client->tags;
+    if (force || stw != bar->tray_w) {
+        resize_bar_win(dpy, m, systray);
+        bar->tray_w = stw;
+    }
+
+    /* Status goes first, a long one is overdrawn by the tags */
+    bool status_changed = force || strcmp(stext, bar->status.text) != 0;
+    int sw = status_changed ? (int)TEXTW(stext) - lrpad / 2 + 2 : bar->status.span.w; /* 2px right padding */
+    BarSpan status = { m->ww - sw - stw, sw };
+    if (status_changed || bar_span_moved(status, bar->status.span)) {
+        drw->scheme = scheme[SchemeNorm];
+        drw_text(drw, status.x, 0, status.w, m->bh, lrpad / 2 - 2, stext, 0);
+        drw_map(drw, m->bar_win, status.x, 0, status.w, m->bh);
+        strcpy(bar->status.text, stext);
+        bar->status.span = status;
+        bar_segments_drawn++;
+        if (status.x < bar->layout.span.x + bar->layout.span.w) {
+            force = true;
         }
     }
-    int x = 0;
-    int w;
+
+    BarSpan tag_span = { 0, 0 };
     for (unsigned int i = 0; i < TAGS_LEN; i++) {
-        w = TEXTW(tags[i]);
-        drw->scheme = scheme[(m->tagset[m->seltags] & 1 << i) ? SchemeSel : SchemeNorm];
-        drw_text(drw, x, 0, w, m->bh, lrpad / 2, tags[i], urg & 1 << i);
-        if (occ & 1 << i) {
-            drw_rect(drw, x + boxs, boxs, boxw, boxw,
-                first_monitor->selected_client && first_monitor->selected_client->tags & 1 << i,urg & 1 << i);
+        if (shown & TAGBIT(i)) {
+            tag_span.w += tag_width[i];
         }
-        x += w;
     }
-    w = 0;
-    drw->scheme = scheme[SchemeNorm];
-
-    if ((w = m->ww - sw - stw - x) > m->bh) {
-        if (m->selected_client && show_title) {
+    if (force || bar_span_moved(tag_span, bar->tags.span) || shown != bar->tags.shown
+            || occ != bar->tags.occupied || urg != bar->tags.urgent
+            || m->tagset[m->seltags] != bar->tags.selected || focused != bar->tags.focused) {
+        int x = 0;
+        for (unsigned int i = 0; i < TAGS_LEN; i++) {
+            if (!(shown & TAGBIT(i))) {
+                continue;
+            }
+            drw->scheme = scheme[(m->tagset[m->seltags] & TAGBIT(i)) ? SchemeSel : SchemeNorm];
+            drw_text(drw, x, 0, tag_width[i], m->bh, lrpad / 2, tags[i], (urg & TAGBIT(i)) != 0);
+            if (occ & TAGBIT(i)) {
+                drw_rect(drw, x + boxs, boxs, boxw, boxw, (focused & TAGBIT(i)) != 0, (urg & TAGBIT(i)) != 0);
+            }
+            x += tag_width[i];
+        }
+        drw_map(drw, m->bar_win, tag_span.x, 0, tag_span.w, m->bh);
+        bar->tags.span = tag_span;
+        bar->tags.shown = shown;
+        bar->tags.occupied = occ;
+        bar->tags.urgent = urg;
+        bar->tags.selected = m->tagset[m->seltags];
+        bar->tags.focused = focused;
+        bar_segments_drawn++;
+    }
+
+    bool symbol_changed = force || m->layout->symbol != bar->layout.symbol;
+    BarSpan symbol = { tag_span.w, symbol_changed ? (int)TEXTW(m->layout->symbol) : bar->layout.span.w };
+    if (symbol_changed || bar_span_moved(symbol, bar->layout.span)) {
+        drw->scheme = scheme[SchemeNorm];
+        drw_text(drw, symbol.x, 0, symbol.w, m->bh, lrpad / 2, m->layout->symbol, 0);
+        drw_map(drw, m->bar_win, symbol.x, 0, symbol.w, m->bh);
+        bar->layout.symbol = m->layout->symbol;
+        bar->layout.span = symbol;
+        bar_segments_drawn++;
+    }
+
+    BarSpan title = { symbol.x + symbol.w, status.x - symbol.x - symbol.w };
+    if (title.w <= m->bh) {
+        bar->title.span = title;
+        return;
+    }
+    if (force || bar_span_moved(title, bar->title.span) || c != bar->title.client
+            || (c && (strcmp(c->cold->name, bar->title.name) != 0
+                || c->is_floating != bar->title.floating || c->cold->is_fixed != bar->title.fixed))) {
+        if (c) {
             drw->scheme = scheme[SchemeSel];
-            drw_text(drw, x, 0, w, m->bh, lrpad / 2, m->selected_client->name, 0);
-            if (m->selected_client->is_floating) {
-                drw_rect(drw, x + boxs, boxs, boxw, boxw, m->selected_client->is_fixed, 0);
+            drw_text(drw, title.x, 0, title.w, m->bh, lrpad / 2, c->cold->name, 0);
+            if (c->is_floating) {
+                drw_rect(drw, title.x + boxs, boxs, boxw, boxw, c->cold->is_fixed, 0);
             }
+            strcpy(bar->title.name, c->cold->name);
+            bar->title.floating = c->is_floating;
+            bar->title.fixed = c->cold->is_fixed;
         } else {
             drw->scheme = scheme[SchemeNorm];
-            drw_rect(drw, x, 0, w, m->bh, 1, 1);
+            drw_rect(drw, title.x, 0, title.w, m->bh, 1, 1);
         }
+        drw_map(drw, m->bar_win, title.x, 0, title.w, m->bh);
+        bar->title.client = c;
+        bar->title.span = title;
+        bar_segments_drawn++;
+    }
+}
+
+/* Tags that get a bar cell: occupied or in view. Empty hidden tags are
+ * left out so the bar does not grow with the number of tags. The urgent
+ * and occupied tags come out of the same walk, either may be NULL. */
+Tagset bar_tags(const Monitor *m, Tagset *urgent, Tagset *occupied)
+{
+    Tagset occ = 0, urg = 0;
+
+    for (Client *client = m->clients; client; client = client->next) {
+        occ |= client->tags;
+        if (client->is_urgent) {
+            urg |= client->tags;
+        }
+    }
+    if (urgent) {
+        *urgent = urg;
+    }
+    if (occupied) {
+        *occupied = occ;
+    }
+    return (occ | m->tagset[m->seltags]) & TAGMASK;
+}
+
+/* Applies everything handlers marked dirty, once per event batch */
+void flush_monitor(Monitor *m)
+{
+    unsigned long first_request = NextRequest(dpy);
+
+    if (m->dirty & DirtyArrange) {
+        showhide(m);
+        update_tiled(m);
+        apply_layout(m);
+        if (hide_by_unmap && m->layout->follows_focus) {
+            show_layout_top(m);
+        }
+        m->dirty |= DirtyRestack;
+    }
+    if (m->dirty & DirtySystray) {
+        update_systray(dpy, m);
+        /* The bar window shrinks or grows with the systray gap */
+        m->dirty |= DirtyBar;
+    }
+    if (m->dirty & DirtyRestack) {
+        restack(m);
+        m->dirty |= DirtyBar;
+        /* Windows moving under the pointer must not steal focus */
+        ignore_enters_since(first_request);
+    }
+    if (m->dirty & DirtyBar) {
+        draw_bar(m);
+    }
+    m->dirty = 0;
+    XFlush(dpy);
+}
+
+/* EnterNotify events caused by requests from first_request on are ignored */
+void ignore_enters_since(unsigned long first_request)
+{
+    enter_ignore_first = first_request;
+    enter_ignore_last = NextRequest(dpy) - 1;
+    if (enter_ignore_last >= enter_ignore_first) {
+        /* Later events carry the serial of the last request sent, fence
+         * the range so the next real crossing falls outside it */
+        XNoOp(dpy);
     }
-    drw_map(drw, m->bar_win, 0, 0, m->ww - stw, m->bh);
 }
 
 void enter_notify(XEvent *e)
@@ -794,6 +1078,9 @@ void enter_notify(XEvent *e)
     if ((ev->mode != NotifyNormal || ev->detail == NotifyInferior) && ev->window != root) {
         return;
     }
+    if (ev->serial >= enter_ignore_first && ev->serial <= enter_ignore_last) {
+        return;
+    }
     Client *client = window_to_client(ev->window);
     if (!client || client == first_monitor->selected_client) {
         return;
@@ -801,11 +1088,22 @@ void enter_notify(XEvent *e)
     focus(dpy, first_monitor, root,client);
 }
 
+/* The bar pixmap always holds the last drawn bar, so damage is repaired by
+ * copying back the exposed rectangle. The systray has a background pixel
+ * and its icons repaint themselves, nothing to do there. */
 void expose(XEvent *e)
 {
-    if (e->xexpose.count == 0) {
-        draw_bar(first_monitor);
-        update_systray(dpy, first_monitor);
+    const XExposeEvent *ev = &e->xexpose;
+    Monitor *m = first_monitor;
+
+    if (ev->window != m->bar_win) {
+        return;
+    }
+    if (m->bar.valid) {
+        drw_set_target(drw, m->bar.buf, m->bar.buf_w, m->bar.buf_h);
+        drw_map(drw, m->bar_win, ev->x, ev->y, ev->width, ev->height);
+    } else {
+        m->dirty |= DirtyBar;
     }
 }
 
@@ -824,19 +1122,27 @@ void focus(Display *dpy, Monitor *mon, Window root, Client *c)
         detach_stack(mon, c);
         attach_stack(mon, c);
         grab_buttons(c, true);
-        XSetWindowBorder(dpy, c->win, scheme[SchemeSel][ColBorder].pixel);
+        client_set_border(c, scheme[SchemeSel][ColBorder].pixel);
+        if (c->hidden) {
+            /* Unmapped by show_layout_top, or its tag view is not flushed
+             * yet. An unmapped window cannot take input focus. */
+            client_show(c);
+        }
         set_focus(dpy, c);
     } else {
         XSetInputFocus(dpy, root, RevertToPointerRoot, CurrentTime);
         XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
     }
     mon->selected_client = c;
-    draw_bar(mon);
+    mon->dirty |= DirtyBar;
+    if (mon->layout->follows_focus && c && !c->is_floating && c != mon->layout_top) {
+        arrange(mon);
+    }
 }
 
 void focus_in(XEvent *e)
 {
-    if (first_monitor->selected_client && e->xfocus.window != first_monitor->selected_client->win) {
+    if (first_monitor->selected_client && e->xfocus.window != first_monitor->selected_client->cold->win) {
         set_focus(dpy, first_monitor->selected_client);
     }
 }
@@ -853,7 +1159,7 @@ void focus_next(const Arg *arg)
     }
     if (c) {
         focus(dpy, first_monitor, root,  c);
-        restack(first_monitor);
+        first_monitor->dirty |= DirtyRestack;
     }
 }
 
@@ -875,15 +1181,11 @@ void focus_previous(const Arg *arg)
     if (!first_monitor->selected_client) {
         return;
     }
-    Client *c = NULL;
-    Client *i = first_monitor->clients;
-    for (; i != first_monitor->selected_client; i = i->next) {
-        if (ISVISIBLE(i)) {
-            c = i;
-        }
-    }
+    Client *c = first_monitor->selected_client->cold->prev;
+    for (; c && !ISVISIBLE(c); c = c->cold->prev);
     if (!c) {
-        for (; i; i = i->next) {
+        /* Wrap around to the last visible client */
+        for (Client *i = first_monitor->selected_client; i; i = i->next) {
             if (ISVISIBLE(i)) {
                 c = i;
             }
@@ -891,7 +1193,7 @@ void focus_previous(const Arg *arg)
     }
     if (c) {
         focus(dpy, first_monitor, root,  c);
-        restack(first_monitor);
+        first_monitor->dirty |= DirtyRestack;
     }
 }
 
@@ -901,7 +1203,7 @@ Atom get_atom_prop(Client *c, Atom prop)
     unsigned long dl;
     unsigned char *p = NULL;
     Atom da, atom = None;
-    if (XGetWindowProperty(dpy, c->win, prop, 0L, sizeof atom, False, XA_ATOM, &da, &di, &dl, &dl, &p) == Success && p) {
+    if (XGetWindowProperty(dpy, c->cold->win, prop, 0L, sizeof atom, False, XA_ATOM, &da, &di, &dl, &dl, &p) == Success && p) {
         atom = *(Atom *)p;
         XFree(p);
     }
@@ -916,68 +1218,218 @@ int get_root_ptr(int *x, int *y)
     return XQueryPointer(dpy, root, &dummy, &dummy, x, y, &di, &di, &dui);
 }
 
-long get_state(Window w)
+
+bool get_text_prop(Window w, Atom atom, char *text, unsigned int size)
 {
-    int format;
-    long result = -1;
-    unsigned char *p = NULL;
-    unsigned long n, extra;
-    Atom real;
+    XTextProperty name;
 
-    if (XGetWindowProperty(dpy, w, wmatom[WMState], 0L, 2L, False, wmatom[WMState],
-        &real, &format, &n, &extra, (unsigned char **)&p) != Success) {
-        return -1;
+    if (!text || size == 0) {
+        return false;
     }
-    if (n != 0) {
-        result = *p;
+    text[0] = '\0';
+    if (!XGetTextProperty(dpy, w, &name, atom)) {
+        return false;
     }
-    XFree(p);
-    return result;
+    bool found = text_prop_to_string(&name, text, size);
+    XFree(name.value);
+    return found;
 }
 
-
-bool get_text_prop(Window w, Atom atom, char *text, unsigned int size)
+bool text_prop_to_string(XTextProperty *name, char *text, unsigned int size)
 {
     char **list = NULL;
-    XTextProperty name;
 
-    if (!text || size == 0) {
-        return false;
-    }
     text[0] = '\0';
-    if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems) {
+    if (!name->nitems) {
         return false;
     }
-    if (name.encoding == XA_STRING) {
-        strncpy(text, (char *)name.value, size - 1);
+    if (name->encoding == XA_STRING) {
+        size_t len = MIN(name->nitems, size - 1);
+        memcpy(text, name->value, len);
+        text[len] = '\0';
     } else {
         int n;
-        if (XmbTextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 && *list) {
+        if (XmbTextPropertyToTextList(dpy, name, &list, &n) >= Success && n > 0 && *list) {
             strncpy(text, *list, size - 1);
+            if (strlen(*list) > size - 1) {
+                /* Do not leave half a UTF-8 sequence at the end */
+                size_t len = size - 1;
+                while (len && ((unsigned char)(*list)[len] & 0xC0) == 0x80) {
+                    len--;
+                }
+                text[len] = '\0';
+            }
             XFreeStringList(list);
         }
     }
     text[size - 1] = '\0';
-    XFree(name.value);
     return true;
 }
 
-void grab_buttons(Client *c, bool focused)
+/* Sends a GetProperty for every property in mask before waiting for any
+ * reply, so the whole set costs a single round trip. */
+void fetch_props(Window w, unsigned int mask, ClientProps *props)
 {
-    update_numlock_mask(&numlockmask);
-    {
-        unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
-        XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
-        if (!focused) {
-            XGrabButton(dpy, AnyButton, AnyModifier, c->win, False, BUTTONMASK, GrabModeSync, GrabModeSync, None, None);
+    request_props(w, mask, props);
+    collect_props(props);
+}
+
+/* Only sends the requests, several windows can be in flight before the
+ * first collect_props */
+void request_props(Window w, unsigned int mask, ClientProps *props)
+{
+    const Atom atoms[PropLast] = {
+        [PropNetWMName] = netatom[NetWMName],         [PropWMName] = XA_WM_NAME,
+        [PropTransientFor] = XA_WM_TRANSIENT_FOR,
+        [PropNetWMState] = netatom[NetWMState],       [PropWindowType] = netatom[NetWMWindowType],
+        [PropNormalHints] = XA_WM_NORMAL_HINTS,       [PropWMHints] = XA_WM_HINTS,
+        [PropProtocols] = wmatom[WMProtocols],
+    };
+    static const Atom types[PropLast] = {
+        [PropNetWMName] = XCB_GET_PROPERTY_TYPE_ANY,  [PropWMName] = XCB_GET_PROPERTY_TYPE_ANY,
+        [PropTransientFor] = XA_WINDOW,
+        [PropNetWMState] = XA_ATOM,                   [PropWindowType] = XA_ATOM,
+        [PropNormalHints] = XA_WM_SIZE_HINTS,         [PropWMHints] = XA_WM_HINTS,
+        [PropProtocols] = XA_ATOM,
+    };
+    /* In 32-bit units */
+    static const uint32_t lengths[PropLast] = {
+        [PropNetWMName] = 256, [PropWMName] = 256, [PropTransientFor] = 1,
+        [PropNetWMState] = 1, [PropWindowType] = 1, [PropNormalHints] = 18, [PropWMHints] = 9,
+        [PropProtocols] = 32,
+    };
+
+    props->mask = mask;
+    for (unsigned int i = 0; i < PropLast; i++) {
+        props->reply[i] = NULL;
+        if (mask & PROP(i)) {
+            props->cookie[i] = xcb_get_property(xcb, 0, w, atoms[i], types[i], 0, lengths[i]);
         }
-        for (unsigned int i = 0; i < LENGTH(buttons); i++) {
-            if (buttons[i].click == ClkClientWin) {
-                for (unsigned int j = 0; j < LENGTH(modifiers); j++) {
-                    XGrabButton(dpy, buttons[i].button,
-                        buttons[i].mask | modifiers[j], c->win, False, BUTTONMASK,
-                        GrabModeAsync, GrabModeSync, None, None);
-                }
+    }
+}
+
+void collect_props(ClientProps *props)
+{
+    xcb_generic_error_t *error;
+
+    for (unsigned int i = 0; i < PropLast; i++) {
+        if (!(props->mask & PROP(i))) {
+            continue;
+        }
+        props->reply[i] = xcb_get_property_reply(xcb, props->cookie[i], &error);
+        free(error);
+        if (props->reply[i] && props->reply[i]->type == XCB_NONE) {
+            /* The property is not set */
+            free(props->reply[i]);
+            props->reply[i] = NULL;
+        }
+    }
+}
+
+void free_props(ClientProps *props)
+{
+    for (unsigned int i = 0; i < PropLast; i++) {
+        free(props->reply[i]);
+    }
+}
+
+/* Properties to refetch when atom changes on a client */
+unsigned int props_for_atom(Atom atom)
+{
+    if (atom == XA_WM_NAME || atom == netatom[NetWMName]) {
+        return PROP(PropNetWMName) | PROP(PropWMName);
+    } else if (atom == XA_WM_TRANSIENT_FOR) {
+        return PROP(PropTransientFor);
+    } else if (atom == XA_WM_NORMAL_HINTS) {
+        return PROP(PropNormalHints);
+    } else if (atom == XA_WM_HINTS) {
+        return PROP(PropWMHints);
+    } else if (atom == netatom[NetWMWindowType]) {
+        return PROP(PropNetWMState) | PROP(PropWindowType);
+    } else if (atom == wmatom[WMProtocols]) {
+        return PROP(PropProtocols);
+    }
+    return 0;
+}
+
+const uint32_t *prop_items(const xcb_get_property_reply_t *reply, int *n)
+{
+    if (!reply || reply->format != 32 || !reply->value_len) {
+        *n = 0;
+        return NULL;
+    }
+    *n = reply->value_len;
+    return xcb_get_property_value(reply);
+}
+
+/* First item of a 32-bit property, 0 if it is unset or not of type */
+uint32_t prop_first(const xcb_get_property_reply_t *reply, xcb_atom_t type)
+{
+    int n;
+    const uint32_t *items = prop_items(reply, &n);
+
+    return items && reply->type == type ? items[0] : 0;
+}
+
+Window prop_window(const xcb_get_property_reply_t *reply)
+{
+    return prop_first(reply, XCB_ATOM_WINDOW);
+}
+
+Atom prop_atom(const xcb_get_property_reply_t *reply)
+{
+    return prop_first(reply, XCB_ATOM_ATOM);
+}
+
+bool prop_text(const xcb_get_property_reply_t *reply, char *text, unsigned int size)
+{
+    text[0] = '\0';
+    if (!reply || reply->format != 8) {
+        return false;
+    }
+    XTextProperty name = {
+        .value = xcb_get_property_value(reply),
+        .encoding = reply->type,
+        .format = 8,
+        .nitems = xcb_get_property_value_length(reply),
+    };
+    if (reply->bytes_after) {
+        /* Longer than requested, so the end may split a UTF-8 sequence.
+         * Far more than fits in text is left either way. */
+        while (name.nitems && (name.value[name.nitems - 1] & 0xC0) == 0x80) {
+            name.nitems--;
+        }
+        if (name.nitems && name.value[name.nitems - 1] >= 0xC0) {
+            name.nitems--;
+        }
+    }
+    return text_prop_to_string(&name, text, size);
+}
+
+void grab_buttons(Client *c, bool focused)
+{
+    int state = focused ? GrabFocused : GrabUnfocused;
+
+    if (c->cold->grab_state == state) {
+        return;
+    }
+
+    unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
+    /* Going from focused to unfocused only needs the catch-all grab added;
+     * re-grabbing the bindings below puts them back in front of it. */
+    if (c->cold->grab_state != GrabFocused) {
+        XUngrabButton(dpy, AnyButton, AnyModifier, c->cold->win);
+    }
+    c->cold->grab_state = state;
+    if (!focused) {
+        XGrabButton(dpy, AnyButton, AnyModifier, c->cold->win, False, BUTTONMASK, GrabModeSync, GrabModeSync, None, None);
+    }
+    for (unsigned int i = 0; i < LENGTH(buttons); i++) {
+        if (buttons[i].click == ClkClientWin) {
+            for (unsigned int j = 0; j < LENGTH(modifiers); j++) {
+                XGrabButton(dpy, buttons[i].button,
+                    buttons[i].mask | modifiers[j], c->cold->win, False, BUTTONMASK,
+                    GrabModeAsync, GrabModeSync, None, None);
             }
         }
     }
@@ -985,17 +1437,14 @@ void grab_buttons(Client *c, bool focused)
 
 void grab_keys(void)
 {
-    update_numlock_mask(&numlockmask);
-    {
-        unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
-        KeyCode code;
-
-        XUngrabKey(dpy, AnyKey, AnyModifier, root);
-        for (unsigned int i = 0; i < LENGTH(keys); i++) {
-            if ((code = XKeysymToKeycode(dpy, keys[i].key_symbol))) {
-                for (unsigned int j = 0; j < LENGTH(modifiers); j++) {
-                    XGrabKey(dpy, code, keys[i].mod | modifiers[j], root, True, GrabModeAsync, GrabModeAsync);
-                }
+    unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
+    KeyCode code;
+
+    XUngrabKey(dpy, AnyKey, AnyModifier, root);
+    for (unsigned int i = 0; i < LENGTH(keys); i++) {
+        if ((code = XKeysymToKeycode(dpy, keys[i].key_symbol))) {
+            for (unsigned int j = 0; j < LENGTH(modifiers); j++) {
+                XGrabKey(dpy, code, keys[i].mod | modifiers[j], root, True, GrabModeAsync, GrabModeAsync);
             }
         }
     }
@@ -1019,37 +1468,48 @@ void destroy_client(const Arg *arg)
     if (!first_monitor->selected_client) {
         return;
     }
-    if (!send_event(first_monitor->selected_client->win, wmatom[WMDelete], NoEventMask, wmatom[WMDelete], CurrentTime, 0 , 0, 0)) {
-        XGrabServer(dpy);
-        XSetErrorHandler(xerrordummy);
+    if (!send_event(first_monitor->selected_client->cold->win, wmatom[WMDelete], NoEventMask, wmatom[WMDelete], CurrentTime, 0 , 0, 0)) {
+        xerror_ignore_begin(dpy);
         XSetCloseDownMode(dpy, DestroyAll);
-        XKillClient(dpy, first_monitor->selected_client->win);
-        XSync(dpy, False);
-        XSetErrorHandler(xerror);
-        XUngrabServer(dpy);
+        XKillClient(dpy, first_monitor->selected_client->cold->win);
+        xerror_ignore_end(dpy);
     }
 }
 
 void manage(Window w, const XWindowAttributes *wa)
+{
+    /* One round trip for everything adopt needs instead of one per property */
+    ClientProps props;
+    fetch_props(w, PROP_ALL, &props);
+    adopt(w, wa, &props);
+    free_props(&props);
+    arrange(first_monitor);
+    focus(dpy, first_monitor, root, NULL);
+}
+
+/* Takes w under management without arranging or focusing, which the caller
+ * does once it has adopted all of its windows */
+void adopt(Window w, const XWindowAttributes *wa, const ClientProps *props)
 {
     Client *t = NULL;
     Window trans = None;
-    XWindowChanges wc;
 
     Client *c = client_init();
-    c->win = w;
+    c->cold->win = w;
     /* Geometry */
-    c->x = c->oldx = wa->x;
-    c->y = c->oldy = wa->y;
-    c->w = c->oldw = wa->width;
-    c->h = c->oldh = wa->height;
-    c->oldbw = wa->border_width;
-
-    update_title(c);
-    if (XGetTransientForHint(dpy, w, &trans) && (t = window_to_client(trans))) {
+    c->x = c->cold->oldx = c->server.x = wa->x;
+    c->y = c->cold->oldy = c->server.y = wa->y;
+    c->w = c->cold->oldw = c->server.w = wa->width;
+    c->h = c->cold->oldh = c->server.h = wa->height;
+    c->cold->oldbw = c->server.bw = wa->border_width;
+    c->cold->server.mapped = wa->map_state != IsUnmapped;
+
+    update_title(c, props);
+    if (props->reply[PropTransientFor] && (trans = prop_window(props->reply[PropTransientFor])) != None
+    && (t = window_to_client(trans))) {
         c->tags = t->tags;
     } else {
-        apply_rules(dpy, first_monitor, c);
+        apply_rules(first_monitor, c);
     }
 
     if (c->x + WIDTH(c) > first_monitor->wx + first_monitor->ww) {
@@ -1062,37 +1522,36 @@ void manage(Window w, const XWindowAttributes *wa)
     c->y = MAX(c->y, first_monitor->wy);
     c->bw = borderpx;
 
-    wc.border_width = c->bw;
-    XConfigureWindow(dpy, w, CWBorderWidth, &wc);
-    XSetWindowBorder(dpy, w, scheme[SchemeNorm][ColBorder].pixel);
+    client_configure(c, c->server.x, c->server.y, c->server.w, c->server.h, c->bw);
+    client_set_border(c, scheme[SchemeNorm][ColBorder].pixel);
     configure(dpy, c); /* Propagates border_width, if size doesn't change */
-    update_window_type(c);
-    update_size_hints(c);
-    update_wm_hints(dpy, first_monitor, c);
+    update_window_type(c, props);
+    update_size_hints(c, props);
+    update_wm_hints(dpy, first_monitor, c, props);
+    update_protocols(c, props);
     c->x = first_monitor->mx + (first_monitor->mw - WIDTH(c)) / 2;
     c->y = first_monitor->my + (first_monitor->mh - HEIGHT(c)) / 2;
-    c->sfx = c->x;
-    c->sfy = c->y;
-    c->sfw = c->w;
-    c->sfh = c->h;
+    c->cold->sfx = c->x;
+    c->cold->sfy = c->y;
+    c->cold->sfw = c->w;
+    c->cold->sfh = c->h;
     XSelectInput(dpy, w, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
     grab_buttons(c, false);
     if (!c->is_floating) {
-        c->is_floating = (c->oldstate = trans != None || c->is_fixed);
+        c->is_floating = (c->cold->oldstate = trans != None || c->cold->is_fixed);
     }
     if (c->is_floating) {
-        XRaiseWindow(dpy, c->win);
+        client_raise(c);
     }
     attach(first_monitor, c);
     attach_stack(first_monitor, c);
-    XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend, (unsigned char *) &(c->win), 1);
-    XMoveResizeWindow(dpy, c->win, c->x + 2 * screen_width, c->y, c->w, c->h); /* Some windows require this */
+    winmap_insert(&client_index, c->cold->win, c);
+    XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend, (unsigned char *) &(c->cold->win), 1);
+    client_configure(c, c->x + 2 * screen_width, c->y, c->w, c->h, c->server.bw); /* Some windows require this */
     set_client_state(c, NormalState);
     unfocus(first_monitor->selected_client, false);
     first_monitor->selected_client = c;
-    arrange(first_monitor);
-    XMapWindow(dpy, c->win);
-    focus(dpy, first_monitor, root, NULL);
+    client_map(c, false);
 }
 
 void mapping_notify(XEvent *e)
@@ -1100,9 +1559,21 @@ void mapping_notify(XEvent *e)
     XMappingEvent *ev = &e->xmapping;
     XRefreshKeyboardMapping(ev);
 
-    if (ev->request == MappingKeyboard) {
+    if (ev->request != MappingKeyboard && ev->request != MappingModifier) {
+        return;
+    }
+    unsigned int old_numlockmask = numlockmask;
+    update_numlock_mask(&numlockmask);
+    if (ev->request == MappingKeyboard || numlockmask != old_numlockmask) {
         grab_keys();
     }
+    if (numlockmask != old_numlockmask) {
+        /* Button grabs carry the old numlock combinations, redo them all */
+        for (Client *c = first_monitor->clients; c; c = c->next) {
+            c->cold->grab_state = GrabNone;
+            grab_buttons(c, c == first_monitor->selected_client);
+        }
+    }
 }
 
 void map_request(XEvent *e)
@@ -1111,9 +1582,8 @@ void map_request(XEvent *e)
     XMapRequestEvent *ev = &e->xmaprequest;
     Client *i = window_to_systray_icon(systray, ev->window);
     if (i) {
-        send_event(i->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_WINDOW_ACTIVATE, 0, systray->win, XEMBED_EMBEDDED_VERSION);
-        resize_bar_win(dpy, first_monitor, systray);
-        update_systray(dpy, first_monitor);
+        send_event(i->cold->win, netatom[Xembed], StructureNotifyMask, CurrentTime, XEMBED_WINDOW_ACTIVATE, 0, systray->win, XEMBED_EMBEDDED_VERSION);
+        first_monitor->dirty |= DirtySystray;
     }
 
     if (!XGetWindowAttributes(dpy, ev->window, &wa)) {
@@ -1143,7 +1613,8 @@ void move_with_mouse(const Arg *arg)
     if (client->is_fullscreen) {
         return;
     }
-    restack(first_monitor);
+    first_monitor->dirty |= DirtyRestack;
+    flush_monitor(first_monitor);
     ocx = client->x;
     ocy = client->y;
     if (XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync, None, cursor[CurMove]->cursor, CurrentTime) != GrabSuccess) {
@@ -1159,6 +1630,7 @@ void move_with_mouse(const Arg *arg)
         case Expose:
         case MapRequest:
             handler[ev.type](&ev);
+            flush_monitor(first_monitor);
             break;
         case MotionNotify:
             if ((ev.xmotion.time - last_time) <= (1000 / 60)) {
@@ -1170,9 +1642,11 @@ void move_with_mouse(const Arg *arg)
             ny = ocy + (ev.xmotion.y - y);
             if (!client->is_floating) {
                 toggle_floating(NULL);
+                /* Re-tile the others and restack now, not after the release */
+                flush_monitor(first_monitor);
             }
             if (client->is_floating) {
-                resize(client, nx, ny, client->w, client->h, true);
+                resize(client, nx, ny, client->w, client->h, true, false);
             }
             break;
         }
@@ -1190,17 +1664,19 @@ void property_notify(XEvent *e)
 {
     Client *c;
     Window trans;
+    ClientProps props;
     XPropertyEvent *ev = &e->xproperty;
 
     if ((c = window_to_systray_icon(systray, ev->window))) {
         if (ev->atom == XA_WM_NORMAL_HINTS) {
-            update_size_hints(c);
+            fetch_props(c->cold->win, PROP(PropNormalHints), &props);
+            update_size_hints(c, &props);
+            free_props(&props);
             update_systray_icon_geometry(first_monitor, c, c->w, c->h);
         } else {
             update_systray_icon_state(c, ev);
         }
-        resize_bar_win(dpy, first_monitor, systray);
-        update_systray(dpy, first_monitor);
+        first_monitor->dirty |= DirtySystray;
     }
     if ((ev->window == root) && (ev->atom == XA_WM_NAME)) {
         update_status();
@@ -1208,31 +1684,37 @@ void property_notify(XEvent *e)
     } else if (ev->state == PropertyDelete) {
         return; 
     } else if ((c = window_to_client(ev->window))) {
+        fetch_props(c->cold->win, props_for_atom(ev->atom), &props);
         switch(ev->atom) {
         default: break;
         case XA_WM_TRANSIENT_FOR:
-            if (!c->is_floating && (XGetTransientForHint(dpy, c->win, &trans)) &&
+            trans = prop_window(props.reply[PropTransientFor]);
+            if (!c->is_floating && props.reply[PropTransientFor] &&
                 (c->is_floating = (window_to_client(trans)) != NULL)) {
                 arrange(first_monitor);
             }
             break;
         case XA_WM_NORMAL_HINTS:
-            update_size_hints(c);
+            update_size_hints(c, &props);
             break;
         case XA_WM_HINTS:
-            update_wm_hints(dpy, first_monitor, c);
-            draw_bar(first_monitor);
+            update_wm_hints(dpy, first_monitor, c, &props);
+            first_monitor->dirty |= DirtyBar;
             break;
         }
         if (ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName]) {
-            update_title(c);
-                if (c == first_monitor->selected_client && show_title) {
-                draw_bar(first_monitor);
-                }
+            update_title(c, &props);
+            if (c == first_monitor->selected_client && show_title) {
+                first_monitor->dirty |= DirtyBar;
+            }
         }
         if (ev->atom == netatom[NetWMWindowType]) {
-            update_window_type(c);
+            update_window_type(c, &props);
+        }
+        if (ev->atom == wmatom[WMProtocols]) {
+            update_protocols(c, &props);
         }
+        free_props(&props);
     }
 }
 
@@ -1241,10 +1723,59 @@ void quit(const Arg *arg)
     running = false;
 }
 
-void resize(Client *c, int x, int y, int w, int h, bool interact)
+void terminate(int signo)
+{
+    (void)signo;
+    running = false;
+}
+
+void dump_stats(int signo)
+{
+    (void)signo;
+    fprintf(stderr, "ndwm: %lu redundant requests suppressed, %lu clients kept their slot in a relayout\n",
+            suppressed_requests, relayout_skipped);
+    fprintf(stderr, "ndwm: %lu bar segments drawn, text widths %lu cached %lu measured\n",
+            bar_segments_drawn, drw->width_hits, drw->width_misses);
+    fprintf(stderr, "ndwm: clients %lu live, %lu peak, %lu reused, %lu chunks of %d\n",
+            client_slab.live, client_slab.peak, client_slab.reused, client_slab.chunk_count, CLIENT_CHUNK);
+}
+
+void run(void)
+{
+    while (running) {
+        /* Replies read while flushing can leave events in Xlib's queue where
+         * epoll cannot see them, only sleep once that queue is empty */
+        if (XPending(dpy)) {
+            x_readable(ConnectionNumber(dpy), NULL);
+        } else {
+            loop_dispatch();
+        }
+        /* Redraw once per batch */
+        flush_monitor(first_monitor);
+    }
+}
+
+/* Drains the whole batch the server has sent */
+void x_readable(int fd, void *data)
+{
+    XEvent ev;
+
+    (void)fd;
+    (void)data;
+    while (running && XPending(dpy)) {
+        XNextEvent(dpy, &ev);
+        if (handler[ev.type]) {
+            /* Call handler */
+            handler[ev.type](&ev);
+        }
+    }
+}
+
+/* sole is set by tile for the only tiled client, which is drawn borderless */
+void resize(Client *c, int x, int y, int w, int h, bool interact, bool sole)
 {
     if (apply_size_hints(first_monitor, c, &x, &y, &w, &h, interact)) {
-        resize_client(dpy, first_monitor, c, x, y, w, h);
+        resize_client(dpy, c, x, y, w, h, sole);
     }
 }
 
@@ -1253,28 +1784,28 @@ void resize_bar_win(Display *display, Monitor *m, Systray *systray)
     XMoveResizeWindow(display, m->bar_win, m->wx, m->by, m->ww - get_systray_width(systray), m->bh);
 }
 
-void resize_client(Display *dpy, Monitor *mon, Client *c, int x, int y, int w, int h)
+void resize_client(Display *dpy, Client *c, int x, int y, int w, int h, bool sole)
 {
     XWindowChanges window_changes;
 
-    c->oldx = c->x; c->x = window_changes.x = x;
-    c->oldy = c->y; c->y = window_changes.y = y;
-    c->oldw = c->w; c->w = window_changes.width = w;
-    c->oldh = c->h; c->h = window_changes.height = h;
+    c->cold->oldx = c->x; c->x = window_changes.x = x;
+    c->cold->oldy = c->y; c->y = window_changes.y = y;
+    c->cold->oldw = c->w; c->w = window_changes.width = w;
+    c->cold->oldh = c->h; c->h = window_changes.height = h;
     window_changes.border_width = c->bw;
 
-    if ((next_tiled_client(mon->clients) == c) && !(next_tiled_client(c->next))) {
-        mon->master_factor = master_factor;
-    }
-
-    if (((next_tiled_client(mon->clients) == c && !next_tiled_client(c->next))) && (!c->is_fullscreen) && !c->is_floating) {
+    if (sole && !c->is_fullscreen && !c->is_floating) {
         c->w = window_changes.width += c->bw * 2;
         c->h = window_changes.height += c->bw * 2;
         window_changes.border_width = 0;
     }
-    XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &window_changes);
-    configure(dpy, c);
-    XSync(dpy, False);
+    /* Layout driven, nothing waits on an answer when nothing changed.
+     * ConfigureRequests are answered by configure_request itself. */
+    xerror_ignore_begin(dpy);
+    if (client_configure(c, window_changes.x, window_changes.y, window_changes.width, window_changes.height, window_changes.border_width)) {
+        configure(dpy, c);
+    }
+    xerror_ignore_end(dpy);
 }
 
 void resize_with_mouse(const Arg *arg)
@@ -1290,13 +1821,14 @@ void resize_with_mouse(const Arg *arg)
     if (c->is_fullscreen) { 
         return;
     }
-    restack(first_monitor);
+    first_monitor->dirty |= DirtyRestack;
+    flush_monitor(first_monitor);
     ocx = c->x;
     ocy = c->y;
     if (XGrabPointer(dpy, root, False, MOUSEMASK, GrabModeAsync, GrabModeAsync, None, cursor[CurResize]->cursor, CurrentTime) != GrabSuccess) {
         return;
     }
-    XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
+    XWarpPointer(dpy, None, c->cold->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
     do {
         XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
         switch(ev.type) {
@@ -1304,6 +1836,7 @@ void resize_with_mouse(const Arg *arg)
         case Expose:
         case MapRequest:
             handler[ev.type](&ev);
+            flush_monitor(first_monitor);
             break;
         case MotionNotify:
             if ((ev.xmotion.time - last_time) <= (1000 / 60)) {
@@ -1317,17 +1850,21 @@ void resize_with_mouse(const Arg *arg)
             && first_monitor->wy + nh >= first_monitor->wy && first_monitor->wy + nh <= first_monitor->wy + first_monitor->wh) {
                 if (!c->is_floating) {
                     toggle_floating(NULL);
+                    /* Re-tile the others and restack now, not after the release */
+                    flush_monitor(first_monitor);
                 }
             }
             if (c->is_floating) {
-                resize(c, c->x, c->y, nw, nh, true);
+                resize(c, c->x, c->y, nw, nh, true, false);
             }
             break;
         }
     } while (ev.type != ButtonRelease);
-    XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
+    unsigned long first_request = NextRequest(dpy);
+    XWarpPointer(dpy, None, c->cold->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
     XUngrabPointer(dpy, CurrentTime);
-    while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+    /* Warping to the corner may cross into a neighbour */
+    ignore_enters_since(first_request);
 }
 
 void resize_request(XEvent *e)
@@ -1337,71 +1874,162 @@ void resize_request(XEvent *e)
 
     if (i) {
         update_systray_icon_geometry(first_monitor, i, event->width, event->height);
-        resize_bar_win(dpy, first_monitor, systray);
-        update_systray(dpy, first_monitor);
+        first_monitor->dirty |= DirtySystray;
     }
 }
 
+/* Stacking, top first: floating clients in focus order, the systray and the
+ * bar, m->layout_top, then the other tiled clients in layout order. Only
+ * layouts whose slots overlap, like monocle, set layout_top, and they follow
+ * focus. Under the others tiled clients keep layout order, so a focus change
+ * restacks nothing. */
 void restack(Monitor *m)
 {
-    XEvent ev;
-    XWindowChanges wc;
+    unsigned int n = 1;
 
-    draw_bar(m);
-    if (!m->selected_client) {
-        return;
+    for (Client *c = m->clients; c; c = c->next, n++);
+    if (n > m->stack_cap) {
+        m->stack_cap = MAX(n, 2 * m->stack_cap);
+        free(m->stack_order);
+        free(m->stack_scratch);
+        free(m->stack_wins);
+        m->stack_order = ecalloc(m->stack_cap, sizeof(Client *));
+        m->stack_scratch = ecalloc(m->stack_cap, sizeof(Client *));
+        m->stack_wins = ecalloc(m->stack_cap + 1, sizeof(Window));
+        m->stack_len = 0;
     }
-    if (m->selected_client->is_floating) {
-        XRaiseWindow(dpy, m->selected_client->win);
-    }
-    wc.stack_mode = Below;
-    wc.sibling = m->bar_win;
+
+    /* The order is compared as client records, so windows, which live in
+     * the cold records, are only read when it changed */
+    Client **order = m->stack_scratch;
+    n = 0;
     for (Client *c = m->stack; c; c = c->stack_next) {
-        if (!c->is_floating && ISVISIBLE(c)) {
-            XConfigureWindow(dpy, c->win, CWSibling|CWStackMode, &wc);
-            wc.sibling = c->win;
+        if (c->is_floating && ISVISIBLE(c)) {
+            order[n++] = c;
         }
     }
-    XSync(dpy, False);
-    while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+    order[n++] = NULL; /* The systray and the bar */
+    if (m->layout_top) {
+        order[n++] = m->layout_top;
+    }
+    for (Client *c = m->clients; c; c = c->next) {
+        if (!c->is_floating && ISVISIBLE(c) && c != m->layout_top) {
+            order[n++] = c;
+        }
+    }
+
+    if (n == m->stack_len && !memcmp(order, m->stack_order, n * sizeof(Client *))) {
+        suppressed_requests += n - 1 + (systray != NULL);
+        return;
+    }
+    Window *wins = m->stack_wins;
+    unsigned int w = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        if (order[i]) {
+            wins[w++] = order[i]->cold->win;
+            continue;
+        }
+        if (systray) {
+            wins[w++] = systray->win;
+        }
+        wins[w++] = m->bar_win;
+    }
+    xerror_ignore_begin(dpy);
+    if (order[0]) {
+        /* XRestackWindows leaves the first window where it is */
+        XRaiseWindow(dpy, wins[0]);
+    }
+    XRestackWindows(dpy, wins, w);
+    xerror_ignore_end(dpy);
+    m->stack_scratch = m->stack_order;
+    m->stack_order = order;
+    m->stack_len = n;
 }
 
+/* Adopts the windows that already exist at startup. Every request for the
+ * whole tree is sent before the first reply is read, so this costs two
+ * round trips however many windows there are: one for attributes, geometry
+ * and WM_STATE, one for the properties of the windows that get managed. */
 void scan(void)
 {
-    unsigned int num;
-    Window d1, d2, *wins = NULL;
-    XWindowAttributes wa;
-
-    if (XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
-        unsigned int i;
-        for (i = 0; i < num; i++) {
-            if (!XGetWindowAttributes(dpy, wins[i], &wa) || wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1)) {
-                continue;
-            }
-            if (wa.map_state == IsViewable || get_state(wins[i]) == IconicState) {
-                manage(wins[i], &wa);
-            }
+    xcb_query_tree_reply_t *tree = xcb_query_tree_reply(xcb, xcb_query_tree(xcb, root), NULL);
+    if (!tree) {
+        return;
+    }
+    int num = xcb_query_tree_children_length(tree);
+    xcb_window_t *wins = xcb_query_tree_children(tree);
+    xcb_get_window_attributes_cookie_t *attr_cookies = ecalloc(num, sizeof(*attr_cookies));
+    xcb_get_geometry_cookie_t *geom_cookies = ecalloc(num, sizeof(*geom_cookies));
+    xcb_get_property_cookie_t *state_cookies = ecalloc(num, sizeof(*state_cookies));
+    XWindowAttributes *attrs = ecalloc(num, sizeof(XWindowAttributes));
+    ClientProps *props = ecalloc(num, sizeof(ClientProps));
+    bool *wanted = ecalloc(num, sizeof(bool));
+    int i;
+
+    for (i = 0; i < num; i++) {
+        attr_cookies[i] = xcb_get_window_attributes(xcb, wins[i]);
+        geom_cookies[i] = xcb_get_geometry(xcb, wins[i]);
+        state_cookies[i] = xcb_get_property(xcb, 0, wins[i], wmatom[WMState], wmatom[WMState], 0, 2);
+    }
+    for (i = 0; i < num; i++) {
+        xcb_get_window_attributes_reply_t *attr = xcb_get_window_attributes_reply(xcb, attr_cookies[i], NULL);
+        xcb_get_geometry_reply_t *geom = xcb_get_geometry_reply(xcb, geom_cookies[i], NULL);
+        xcb_get_property_reply_t *state = xcb_get_property_reply(xcb, state_cookies[i], NULL);
+        int n;
+        const uint32_t *state_items = prop_items(state, &n);
+
+        if (attr && geom && !attr->override_redirect
+        && (attr->map_state == IsViewable || (state_items && state_items[0] == IconicState))) {
+            attrs[i].x = geom->x;
+            attrs[i].y = geom->y;
+            attrs[i].width = geom->width;
+            attrs[i].height = geom->height;
+            attrs[i].border_width = geom->border_width;
+            attrs[i].map_state = attr->map_state;
+            wanted[i] = true;
+            request_props(wins[i], PROP_ALL, &props[i]);
         }
-        for (i = 0; i < num; i++) { 
-            /* Now the transients */
-            if (!XGetWindowAttributes(dpy, wins[i], &wa)) {
-                continue;
-            }
-            if (XGetTransientForHint(dpy, wins[i], &d1) && (wa.map_state == IsViewable || get_state(wins[i]) == IconicState)) {
-                manage(wins[i], &wa);
-            }
+        free(attr);
+        free(geom);
+        free(state);
+    }
+    for (i = 0; i < num; i++) {
+        if (wanted[i]) {
+            collect_props(&props[i]);
+        }
+    }
+    for (i = 0; i < num; i++) {
+        if (wanted[i] && !props[i].reply[PropTransientFor]) {
+            adopt(wins[i], &attrs[i], &props[i]);
         }
-        if (wins) { 
-            XFree(wins);
+    }
+    for (i = 0; i < num; i++) {
+        /* Now the transients, their parents are managed by now */
+        if (wanted[i] && props[i].reply[PropTransientFor]) {
+            adopt(wins[i], &attrs[i], &props[i]);
+        }
+    }
+    for (i = 0; i < num; i++) {
+        if (wanted[i]) {
+            free_props(&props[i]);
         }
     }
+    arrange(first_monitor);
+    focus(dpy, first_monitor, root, NULL);
+    free(wanted);
+    free(props);
+    free(attrs);
+    free(state_cookies);
+    free(geom_cookies);
+    free(attr_cookies);
+    free(tree);
 }
 
 void set_client_state(Client *c, long state)
 {
     long data[] = { state, None };
 
-    XChangeProperty(dpy, c->win, wmatom[WMState], wmatom[WMState], 32, PropModeReplace, (unsigned char *)data, 2);
+    XChangeProperty(dpy, c->cold->win, wmatom[WMState], wmatom[WMState], 32, PropModeReplace, (unsigned char *)data, 2);
 }
 
 bool send_event(Window w, Atom proto, int mask, long d0, long d1, long d2, long d3, long d4)
@@ -1410,15 +2038,10 @@ bool send_event(Window w, Atom proto, int mask, long d0, long d1, long d2, long
     int exists = 0;
 
     if (proto == wmatom[WMTakeFocus] || proto == wmatom[WMDelete]) {
+        /* Answered from the cache kept by update_protocols, no round trip */
+        Client *c = window_to_client(w);
         mt = wmatom[WMProtocols];
-        int n;
-        Atom *protocols;
-        if (XGetWMProtocols(dpy, w, &protocols, &n)) {
-            while (!exists && n--) {
-                exists = protocols[n] == proto;
-            }
-            XFree(protocols);
-        }
+        exists = c && (c->cold->protocols & (proto == wmatom[WMTakeFocus] ? ProtoTakeFocus : ProtoDelete));
     } else {
         exists = True;
         mt = proto;
@@ -1441,34 +2064,34 @@ bool send_event(Window w, Atom proto, int mask, long d0, long d1, long d2, long
 
 void set_focus(Display *dpy, Client *c)
 {
-    if (!c->never_focus) {
-        XSetInputFocus(dpy, c->win, RevertToPointerRoot, CurrentTime);
-        XChangeProperty(dpy, root, netatom[NetActiveWindow], XA_WINDOW, 32, PropModeReplace, (unsigned char *) &(c->win), 1);
+    if (!c->cold->never_focus) {
+        XSetInputFocus(dpy, c->cold->win, RevertToPointerRoot, CurrentTime);
+        XChangeProperty(dpy, root, netatom[NetActiveWindow], XA_WINDOW, 32, PropModeReplace, (unsigned char *) &(c->cold->win), 1);
     }
-    send_event(c->win, wmatom[WMTakeFocus], NoEventMask, wmatom[WMTakeFocus], CurrentTime, 0, 0, 0);
+    send_event(c->cold->win, wmatom[WMTakeFocus], NoEventMask, wmatom[WMTakeFocus], CurrentTime, 0, 0, 0);
 }
 
 void set_fullscreen(Display *dpy, Monitor *mon, Client *c, bool fullscreen)
 {
     if (fullscreen && !c->is_fullscreen) {
-        XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32, PropModeReplace, (unsigned char*)&netatom[NetWMFullscreen], 1);
+        XChangeProperty(dpy, c->cold->win, netatom[NetWMState], XA_ATOM, 32, PropModeReplace, (unsigned char*)&netatom[NetWMFullscreen], 1);
         c->is_fullscreen = true;
-        c->oldstate = c->is_floating;
-        c->oldbw = c->bw;
+        c->cold->oldstate = c->is_floating;
+        c->cold->oldbw = c->bw;
         c->bw = 0;
         c->is_floating = true;
-        resize_client(dpy, mon, c, mon->mx, mon->my, mon->mw, mon->mh);
-        XRaiseWindow(dpy, c->win);
+        resize_client(dpy, c, mon->mx, mon->my, mon->mw, mon->mh, false);
+        client_raise(c);
     } else if (!fullscreen && c->is_fullscreen) {
-        XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32, PropModeReplace, (unsigned char*)0, 0);
+        XChangeProperty(dpy, c->cold->win, netatom[NetWMState], XA_ATOM, 32, PropModeReplace, (unsigned char*)0, 0);
         c->is_fullscreen = false;
-        c->is_floating = c->oldstate;
-        c->bw = c->oldbw;
-        c->x = c->oldx;
-        c->y = c->oldy;
-        c->w = c->oldw;
-        c->h = c->oldh;
-        resize_client(dpy, mon, c, c->x, c->y, c->w, c->h);
+        c->is_floating = c->cold->oldstate;
+        c->bw = c->cold->oldbw;
+        c->x = c->cold->oldx;
+        c->y = c->cold->oldy;
+        c->w = c->cold->oldw;
+        c->h = c->cold->oldh;
+        resize_client(dpy, c, c->x, c->y, c->w, c->h, false);
         arrange(mon);
     }
 }
@@ -1479,7 +2102,7 @@ void increase_master_width(const Arg *arg)
     if (f > 0.95) {
         return;
     }
-    first_monitor->master_factor = first_monitor->pertag->master_factors[first_monitor->pertag->current_tag] = f;
+    first_monitor->master_factor = first_monitor->pertag->tags[first_monitor->pertag->current_tag].master_factor = f;
     arrange(first_monitor);
 }
 
@@ -1489,7 +2112,24 @@ void decrease_master_width(const Arg *arg)
     if (f < 0.05) {
         return;
     }
-    first_monitor->master_factor = first_monitor->pertag->master_factors[first_monitor->pertag->current_tag] = f;
+    first_monitor->master_factor = first_monitor->pertag->tags[first_monitor->pertag->current_tag].master_factor = f;
+    arrange(first_monitor);
+}
+
+void increase_nmaster(const Arg *arg)
+{
+    int n = MAX((int)first_monitor->nmaster + arg->i, 0);
+    first_monitor->nmaster = first_monitor->pertag->tags[first_monitor->pertag->current_tag].nmaster = n;
+    arrange(first_monitor);
+}
+
+void set_layout(const Arg *arg)
+{
+    const Layout *layout = arg->v;
+    if (layout == first_monitor->layout) {
+        return;
+    }
+    first_monitor->layout = first_monitor->pertag->tags[first_monitor->pertag->current_tag].layout = layout;
     arrange(first_monitor);
 }
 
@@ -1507,17 +2147,29 @@ void setup(void)
     /* Clean up any zombies (inherited from .xinitrc, etc) immediately */
     while (waitpid(-1, NULL, WNOHANG) > 0);
 
+    /* Init main loop, the X connection is just one of its sources */
+    loop_init();
+    loop_watch_fd(ConnectionNumber(dpy), x_readable, NULL);
+    loop_handle_signal(SIGHUP, terminate);
+    loop_handle_signal(SIGINT, terminate);
+    loop_handle_signal(SIGTERM, terminate);
+    loop_handle_signal(SIGUSR1, dump_stats);
+
     /* Init screen */
+    xcb = XGetXCBConnection(dpy);
     screen = DefaultScreen(dpy);
     screen_width = DisplayWidth(dpy, screen);
     sh = DisplayHeight(dpy, screen);
     root = RootWindow(dpy, screen);
-    drw = drw_create(dpy, screen, root, screen_width, sh);
+    drw = drw_create(dpy, screen, root);
 
     if (!drw_fontset_create(drw, fonts, LENGTH(fonts))) {
         die("no fonts could be loaded.");
     }
     lrpad = drw->fonts->h;
+    for (unsigned int i = 0; i < TAGS_LEN; i++) {
+        tag_width[i] = TEXTW(tags[i]);
+    }
     update_geometry();
 
     /* Init atoms */
@@ -1526,6 +2178,8 @@ void setup(void)
     wmatom[WMDelete] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
     wmatom[WMState] = XInternAtom(dpy, "WM_STATE", False);
     wmatom[WMTakeFocus] = XInternAtom(dpy, "WM_TAKE_FOCUS", False);
+    wmatom[WMSyncRequest] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+    wmatom[WMPing] = XInternAtom(dpy, "_NET_WM_PING", False);
     netatom[NetActiveWindow] = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
     netatom[NetSupported] = XInternAtom(dpy, "_NET_SUPPORTED", False);
     netatom[NetSystemTray] = XInternAtom(dpy, "_NET_SYSTEM_TRAY_S0", False);
@@ -1578,74 +2232,56 @@ void setup(void)
         |LeaveWindowMask|StructureNotifyMask|PropertyChangeMask;
     XChangeWindowAttributes(dpy, root, CWEventMask|CWCursor, &wa);
     XSelectInput(dpy, root, wa.event_mask);
+    update_numlock_mask(&numlockmask);
     grab_keys();
     focus(dpy, first_monitor, root, NULL);
 }
 
 void set_urgent(Client *c, bool urg)
 {
-    XWMHints *wmh =  XGetWMHints(dpy, c->win);
+    XWMHints *wmh =  XGetWMHints(dpy, c->cold->win);
 
     c->is_urgent = urg;
     if (!wmh) {
         return;
     }
     wmh->flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
-    XSetWMHints(dpy, c->win, wmh);
+    XSetWMHints(dpy, c->cold->win, wmh);
     XFree(wmh);
 }
 
 void go_to_left_tag(const Arg *arg)
 {
     Arg shifted;
-    shifted.ui = first_monitor->tagset[first_monitor->seltags];
-    shifted.ui = (shifted.ui >> 1 | shifted.ui << (TAGS_LEN - 1));
+    shifted.tags = first_monitor->tagset[first_monitor->seltags];
+    shifted.tags = (shifted.tags >> 1 | shifted.tags << (TAGS_LEN - 1));
     view(&shifted);
 }
 
 void go_to_right_tag(const Arg *arg) 
 {
     Arg shifted;
-    shifted.ui = first_monitor->tagset[first_monitor->seltags];
-    shifted.ui = (shifted.ui << 1) | (shifted.ui >> (TAGS_LEN - 1));
+    shifted.tags = first_monitor->tagset[first_monitor->seltags];
+    shifted.tags = (shifted.tags << 1) | (shifted.tags >> (TAGS_LEN - 1));
     view(&shifted);
 }
 
 void move_client_to_right_tag(const Arg *arg)
 {
     Arg shifted;
-    shifted.ui = first_monitor->tagset[first_monitor->seltags];
-    shifted.ui = (shifted.ui << 1) | (shifted.ui >> (TAGS_LEN - 1));
+    shifted.tags = first_monitor->tagset[first_monitor->seltags];
+    shifted.tags = (shifted.tags << 1) | (shifted.tags >> (TAGS_LEN - 1));
     tag(&shifted);
 }
 
 void move_client_to_left_tag(const Arg *arg)
 {
     Arg shifted;
-    shifted.ui = first_monitor->tagset[first_monitor->seltags];
-    shifted.ui = (shifted.ui >> 1 | shifted.ui << (TAGS_LEN - 1));
+    shifted.tags = first_monitor->tagset[first_monitor->seltags];
+    shifted.tags = (shifted.tags >> 1 | shifted.tags << (TAGS_LEN - 1));
     tag(&shifted);
 }
 
-void showhide(Client *c)
-{
-    if (!c) {
-        return;
-    }
-    if (ISVISIBLE(c)) { 
-        /* Show clients top down */
-        XMoveWindow(dpy, c->win, c->x, c->y);
-        if (c->is_floating && !c->is_fullscreen) {
-            resize(c, c->x, c->y, c->w, c->h, false);
-        }
-        showhide(c->stack_next);
-    } else { 
-        /* Hide clients bottom up */
-        showhide(c->stack_next);
-        XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
-    }
-}
-
 void spawn(const Arg *arg)
 {
     struct sigaction sa;
@@ -1655,6 +2291,8 @@ void spawn(const Arg *arg)
         }
         setsid();
         sigemptyset(&sa.sa_mask);
+        /* Signals routed through the main loop are blocked, undo that */
+        sigprocmask(SIG_SETMASK, &sa.sa_mask, NULL);
         sa.sa_flags = 0;
         sa.sa_handler = SIG_DFL;
         sigaction(SIGCHLD, &sa, NULL);
@@ -1676,17 +2314,19 @@ void toggle_floating(const Arg *arg)
         return;
     }
 
-    first_monitor->selected_client->is_floating = !first_monitor->selected_client->is_floating || first_monitor->selected_client->is_fixed;
+    first_monitor->selected_client->is_floating = !first_monitor->selected_client->is_floating || first_monitor->selected_client->cold->is_fixed;
     if (first_monitor->selected_client->is_floating) {
         /* Restore last known float dimensions */
-        resize(first_monitor->selected_client, first_monitor->selected_client->sfx, first_monitor->selected_client->sfy,
-               first_monitor->selected_client->sfw, first_monitor->selected_client->sfh, False);
+        resize(first_monitor->selected_client, first_monitor->selected_client->cold->sfx, first_monitor->selected_client->cold->sfy,
+               first_monitor->selected_client->cold->sfw, first_monitor->selected_client->cold->sfh, false, false);
     } else { 
+        /* A border the client asked for while floating does not fit a slot */
+        first_monitor->selected_client->bw = borderpx;
         /* Save last known float dimensions */
-        first_monitor->selected_client->sfx = first_monitor->selected_client->x;
-        first_monitor->selected_client->sfy = first_monitor->selected_client->y;
-        first_monitor->selected_client->sfw = first_monitor->selected_client->w;
-        first_monitor->selected_client->sfh = first_monitor->selected_client->h;
+        first_monitor->selected_client->cold->sfx = first_monitor->selected_client->x;
+        first_monitor->selected_client->cold->sfy = first_monitor->selected_client->y;
+        first_monitor->selected_client->cold->sfw = first_monitor->selected_client->w;
+        first_monitor->selected_client->cold->sfh = first_monitor->selected_client->h;
     }
     arrange(first_monitor);
 }
@@ -1697,7 +2337,7 @@ void unfocus(Client *c, bool set_focus)
         return;
     }
     grab_buttons(c, false);
-    XSetWindowBorder(dpy, c->win, scheme[SchemeNorm][ColBorder].pixel);
+    client_set_border(c, scheme[SchemeNorm][ColBorder].pixel);
     if (set_focus) {
         XSetInputFocus(dpy, root, RevertToPointerRoot, CurrentTime);
         XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
@@ -1710,20 +2350,37 @@ void unmanage(Client *c, bool destroyed)
 
     detach(first_monitor, c);
     detach_stack(first_monitor, c);
+    if (first_monitor->layout_top == c) {
+        first_monitor->layout_top = NULL;
+    }
+    for (unsigned int i = 0; i <= TAGS_LEN; i++) {
+        if (first_monitor->pertag->tags[i].selected == c) {
+            first_monitor->pertag->tags[i].selected = NULL;
+        }
+    }
 
     if (!destroyed) {
-        wc.border_width = c->oldbw;
-        XGrabServer(dpy); /* Avoid race conditions */
-        XSetErrorHandler(xerrordummy);
-        XSelectInput(dpy, c->win, NoEventMask);
-        XConfigureWindow(dpy, c->win, CWBorderWidth, &wc); /* Restore border */
-        XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
+        wc.border_width = c->cold->oldbw;
+        /* No reply is awaited here. The grab keeps the owner from mapping or
+         * configuring the window in between these requests, so a withdraw
+         * racing ours cannot leave the window half restored. */
+        XGrabServer(dpy);
+        xerror_ignore_begin(dpy);
+        XSelectInput(dpy, c->cold->win, NoEventMask);
+        if (c->hidden) {
+            /* Hand it back mapped, nobody else knows it was hidden */
+            XMapWindow(dpy, c->cold->win);
+        }
+        XConfigureWindow(dpy, c->cold->win, CWBorderWidth, &wc); /* Restore border */
+        XUngrabButton(dpy, AnyButton, AnyModifier, c->cold->win);
         set_client_state(c, WithdrawnState);
-        XSync(dpy, False);
-        XSetErrorHandler(xerror);
+        xerror_ignore_end(dpy);
         XUngrabServer(dpy);
     }
-    free(c);
+    winmap_remove(&client_index, c->cold->win);
+    client_free(c);
+    /* The record may come back for another window, restack must not match it */
+    first_monitor->stack_len = 0;
     focus(dpy, first_monitor, root, NULL);
     update_client_list();
     arrange(first_monitor);
@@ -1735,15 +2392,28 @@ void unmap_notify(XEvent *e)
     XUnmapEvent *ev = &e->xunmap;
 
     if ((client = window_to_client(ev->window))) {
-        if (ev->send_event) {
+        if (!ev->send_event && ev->serial == client->cold->hide_serial) {
+            /* Caused by client_hide: an event carries the serial of our last
+             * request the server processed, so the unmap we sent yields
+             * exactly hide_serial. A client that unmapped itself at any
+             * other point, even just before a map of ours reached the
+             * server, gets another serial and is unmanaged as usual. */
+            return;
+        }
+        if (ev->send_event && client->hidden) {
+            /* ICCCM withdrawal of a window we had unmapped */
+            client->hidden = false;
+            unmanage(client, false);
+        } else if (ev->send_event) {
             set_client_state(client, WithdrawnState);
         } else {
             unmanage(client, false);
         }
     } else if ((client = window_to_systray_icon(systray, ev->window))) {
         /* Sometimes icons occasionally unmap their windows, but do not destroy them. We map those windows back */
-        XMapRaised(dpy, client->win);
-        update_systray(dpy, first_monitor);
+        client->cold->server.mapped = false;
+        client_map(client, true);
+        first_monitor->dirty |= DirtySystray;
     }
 }
 
@@ -1766,13 +2436,33 @@ void update_bar(Display *dpy, Window root, Monitor *mon)
     XMapRaised(dpy, systray->win);
     XMapRaised(dpy, mon->bar_win);
     XSetClassHint(dpy, mon->bar_win, &ch);
+    update_bar_buffer(mon);
+}
+
+/* Keeps the bar buffer as large as the bar, recreating it only when the
+ * bar geometry changed */
+void update_bar_buffer(Monitor *m)
+{
+    Bar *bar = &m->bar;
+
+    if (bar->buf && bar->buf_w == m->ww && bar->buf_h == m->bh) {
+        return;
+    }
+    if (bar->buf) {
+        XFreePixmap(dpy, bar->buf);
+    }
+    bar->buf = XCreatePixmap(dpy, root, m->ww, m->bh, DefaultDepth(dpy, screen));
+    bar->buf_w = m->ww;
+    bar->buf_h = m->bh;
+    bar->valid = false;
+    m->dirty |= DirtyBar;
 }
 
 void update_client_list()
 {
     XDeleteProperty(dpy, root, netatom[NetClientList]);
     for (Client *client = first_monitor->clients; client; client = client->next) {
-        XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend, (unsigned char *) &(client->win), 1);
+        XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend, (unsigned char *) &(client->cold->win), 1);
     }
 }
 
@@ -1796,10 +2486,11 @@ bool update_geometry(void)
 void update_numlock_mask(unsigned int *numlockmask)
 {
     *numlockmask = 0;
+    KeyCode numlock = XKeysymToKeycode(dpy, XK_Num_Lock);
     XModifierKeymap *modmap = XGetModifierMapping(dpy);
     for (unsigned int i = 0; i < 8; i++) {
         for (unsigned int j = 0; j < modmap->max_keypermod; j++) {
-            if (modmap->modifiermap[i * modmap->max_keypermod + j] == XKeysymToKeycode(dpy, XK_Num_Lock)) {
+            if (modmap->modifiermap[i * modmap->max_keypermod + j] == numlock) {
                 *numlockmask = (1 << i);
             }
         }
@@ -1807,57 +2498,97 @@ void update_numlock_mask(unsigned int *numlockmask)
     XFreeModifiermap(modmap);
 }
 
-void update_size_hints(Client *c)
+void update_protocols(Client *c, const ClientProps *props)
 {
-    long msize;
-    XSizeHints size;
+    int n;
+    const uint32_t *protocols = prop_items(props->reply[PropProtocols], &n);
+
+    c->cold->protocols = 0;
+    while (n--) {
+        if (protocols[n] == wmatom[WMTakeFocus]) {
+            c->cold->protocols |= ProtoTakeFocus;
+        } else if (protocols[n] == wmatom[WMDelete]) {
+            c->cold->protocols |= ProtoDelete;
+        } else if (protocols[n] == wmatom[WMSyncRequest]) {
+            c->cold->protocols |= ProtoSyncRequest;
+        } else if (protocols[n] == wmatom[WMPing]) {
+            c->cold->protocols |= ProtoPing;
+        }
+    }
+}
 
-    if (!XGetWMNormalHints(dpy, c->win, &size, &msize)) {
+void update_size_hints(Client *c, const ClientProps *props)
+{
+    int n;
+    XSizeHints size = { 0 };
+    SizeHints *hints = &c->cold->hints;
+    const uint32_t *v = prop_items(props->reply[PropNormalHints], &n);
+
+    if (n >= 15) {
+        /* WM_SIZE_HINTS wire layout, pre-ICCCM clients omit the last three fields */
+        size.flags = v[0];
+        size.min_width = (int32_t)v[5];
+        size.min_height = (int32_t)v[6];
+        size.max_width = (int32_t)v[7];
+        size.max_height = (int32_t)v[8];
+        size.width_inc = (int32_t)v[9];
+        size.height_inc = (int32_t)v[10];
+        size.min_aspect.x = (int32_t)v[11];
+        size.min_aspect.y = (int32_t)v[12];
+        size.max_aspect.x = (int32_t)v[13];
+        size.max_aspect.y = (int32_t)v[14];
+        if (n >= 18) {
+            size.base_width = (int32_t)v[15];
+            size.base_height = (int32_t)v[16];
+        } else {
+            size.flags &= ~(PBaseSize|PWinGravity);
+        }
+    } else {
         /* Size is uninitialized, ensure that size.flags aren't used */
         size.flags = PSize;
     }
 
     if (size.flags & PBaseSize) {
-        c->basew = size.base_width;
-        c->baseh = size.base_height;
+        hints->basew = size.base_width;
+        hints->baseh = size.base_height;
     } else if (size.flags & PMinSize) {
-        c->basew = size.min_width;
-        c->baseh = size.min_height;
+        hints->basew = size.min_width;
+        hints->baseh = size.min_height;
     } else {
-        c->basew = c->baseh = 0;
+        hints->basew = hints->baseh = 0;
     }
 
     if (size.flags & PResizeInc) {
-        c->incw = size.width_inc;
-        c->inch = size.height_inc;
+        hints->incw = size.width_inc;
+        hints->inch = size.height_inc;
     } else {
-        c->incw = c->inch = 0;
+        hints->incw = hints->inch = 0;
     }
 
     if (size.flags & PMaxSize) {
-        c->maxw = size.max_width;
-        c->maxh = size.max_height;
+        hints->maxw = size.max_width;
+        hints->maxh = size.max_height;
     } else {
-        c->maxw = c->maxh = 0;
+        hints->maxw = hints->maxh = 0;
     }
 
     if (size.flags & PMinSize) {
-        c->minw = size.min_width;
-        c->minh = size.min_height;
+        hints->minw = size.min_width;
+        hints->minh = size.min_height;
     } else if (size.flags & PBaseSize) {
-        c->minw = size.base_width;
-        c->minh = size.base_height;
+        hints->minw = size.base_width;
+        hints->minh = size.base_height;
     } else {
-        c->minw = c->minh = 0;
+        hints->minw = hints->minh = 0;
     }
 
     if (size.flags & PAspect) {
-        c->mina = (float)size.min_aspect.y / size.min_aspect.x;
-        c->maxa = (float)size.max_aspect.x / size.max_aspect.y;
+        hints->mina = (float)size.min_aspect.y / size.min_aspect.x;
+        hints->maxa = (float)size.max_aspect.x / size.max_aspect.y;
     } else {
-        c->maxa = c->mina = 0.0;
+        hints->maxa = hints->mina = 0.0;
     }
-    c->is_fixed = (c->maxw && c->maxh && c->maxw == c->minw && c->maxh == c->minh);
+    c->cold->is_fixed = (hints->maxw && hints->maxh && hints->maxw == hints->minw && hints->maxh == hints->minh);
 }
 
 void update_status(void)
@@ -1865,8 +2596,7 @@ void update_status(void)
     if (!get_text_prop(root, XA_WM_NAME, stext, sizeof(stext))) { 
         strcpy(stext, "ndwm");
     }
-    draw_bar(first_monitor);
-    update_systray(dpy, first_monitor);
+    first_monitor->dirty |= DirtyBar | DirtySystray;
 }
 
 void update_systray_icon_geometry(const Monitor *mon, Client *client, int w, int h)
@@ -1875,15 +2605,20 @@ void update_systray_icon_geometry(const Monitor *mon, Client *client, int w, int
         return;
     }
     
-    client->h = mon->bh;
+    /* Client geometry is 16 bit, the hints work on ints */
+    int x = client->x, y = client->y, icon_w, icon_h = mon->bh;
     if (w == h) { 
-        client->w = mon->bh;
+        icon_w = mon->bh;
     } else if (h == mon->bh) { 
-        client->w = w;
+        icon_w = w;
     } else { 
-        client->w = (int) ((float)mon->bh * ((float)w / (float)h));
+        icon_w = (int) ((float)mon->bh * ((float)w / (float)h));
     }
-    apply_size_hints(mon, client, &(client->x), &(client->y), &(client->w), &(client->h), False);
+    apply_size_hints(mon, client, &x, &y, &icon_w, &icon_h, False);
+    client->x = x;
+    client->y = y;
+    client->w = icon_w;
+    client->h = icon_h;
 
     /* Force icons into the systray dimensions if they don't want to */ 
     if (client->h > mon->bh) {
@@ -1906,17 +2641,18 @@ void update_systray_icon_state(Client *i, const XPropertyEvent *ev)
     }
     if (flags & XEMBED_MAPPED && !i->tags) {
         i->tags = 1;
-        XMapRaised(dpy, i->win);
+        client_map(i, true);
         set_client_state(i, NormalState);
     } else if (!(flags & XEMBED_MAPPED) && i->tags) {
         i->tags = 0;
         code = XEMBED_WINDOW_DEACTIVATE;
-        XUnmapWindow(dpy, i->win);
+        XUnmapWindow(dpy, i->cold->win);
+        i->cold->server.mapped = false;
         set_client_state(i, WithdrawnState);
     } else {
         return;
     }
-    send_event(i->win, xatom[Xembed], StructureNotifyMask, CurrentTime, code, 0,systray->win, XEMBED_EMBEDDED_VERSION);
+    send_event(i->cold->win, xatom[Xembed], StructureNotifyMask, CurrentTime, code, 0,systray->win, XEMBED_EMBEDDED_VERSION);
 }
 
 void update_systray(Display *dpy, Monitor *m)
@@ -1929,25 +2665,28 @@ void update_systray(Display *dpy, Monitor *m)
         systray = systray_init(m, &window_attrs);
         if (XGetSelectionOwner(dpy, netatom[NetSystemTray]) == systray->win) {
             send_event(root, xatom[Manager], StructureNotifyMask, CurrentTime, netatom[NetSystemTray], systray->win, 0, 0);
-            XSync(dpy, False);
         } else {
             fprintf(stderr, "ndwm: unable to obtain system tray.\n");
             free(systray);
             systray = NULL;
             return;
         }
+        m->stack_len = 0; /* restack has no client record for the new window */
     }
     unsigned int w = 0;
+    /* Icons may disappear at any time */
+    xerror_ignore_begin(dpy);
     for (Client *client = systray->icons; client; client = client->next) {
         /* Make sure the background color stays the same */
         window_attrs.background_pixel  = scheme[SchemeNorm][ColBg].pixel;
-        XChangeWindowAttributes(dpy, client->win, CWBackPixel, &window_attrs);
-        XMapRaised(dpy, client->win);
+        XChangeWindowAttributes(dpy, client->cold->win, CWBackPixel, &window_attrs);
+        client_map(client, true);
         w += systrayspacing;
         client->x = w;
-        XMoveResizeWindow(dpy, client->win, client->x, 0, client->w, client->h);
+        client_configure(client, client->x, 0, client->w, client->h, client->server.bw);
         w += client->w;
     }
+    xerror_ignore_end(dpy);
     w = w ? w + systrayspacing : 1;
     x -= w;
     XMoveResizeWindow(dpy, systray->win, x, m->by, w, m->bh);
@@ -1960,66 +2699,75 @@ void update_systray(Display *dpy, Monitor *m)
     /* Redraw background */
     XSetForeground(dpy, drw->gc, scheme[SchemeNorm][ColBg].pixel);
     XFillRectangle(dpy, systray->win, drw->gc, 0, 0, w, m->bh);
-    XSync(dpy, False);
 }
 
-void update_title(Client *c)
+void update_title(Client *c, const ClientProps *props)
 {
-    if (!get_text_prop(c->win, netatom[NetWMName], c->name, sizeof c->name)) {
-        get_text_prop(c->win, XA_WM_NAME, c->name, sizeof c->name);
+    if (!prop_text(props->reply[PropNetWMName], c->cold->name, sizeof c->cold->name)) {
+        prop_text(props->reply[PropWMName], c->cold->name, sizeof c->cold->name);
     }
     /* Hack to mark broken clients */
-    if (c->name[0] == '\0') {
-        strcpy(c->name, stext);
+    if (c->cold->name[0] == '\0') {
+        strcpy(c->cold->name, stext);
     }
 }
 
-void update_window_type(Client *c)
+void update_window_type(Client *c, const ClientProps *props)
 {
-    if (get_atom_prop(c, netatom[NetWMState]) == netatom[NetWMFullscreen]) { 
+    if (prop_atom(props->reply[PropNetWMState]) == netatom[NetWMFullscreen]) { 
         set_fullscreen(dpy, first_monitor, c, true);
     }
-    if (get_atom_prop(c, netatom[NetWMWindowType]) == netatom[NetWMWindowTypeDialog]) {
+    if (prop_atom(props->reply[PropWindowType]) == netatom[NetWMWindowTypeDialog]) {
         c->is_floating = true;
     }
 }
 
-void update_wm_hints(Display *dpy, const Monitor *mon, Client *c)
+void update_wm_hints(Display *dpy, const Monitor *mon, Client *c, const ClientProps *props)
 {
-    XWMHints *wm_hints = XGetWMHints(dpy, c->win);
+    int n;
+    const uint32_t *v = prop_items(props->reply[PropWMHints], &n);
 
-    if (wm_hints) {
-        if (c == mon->selected_client && wm_hints->flags & XUrgencyHint) {
-            wm_hints->flags &= ~XUrgencyHint;
-            XSetWMHints(dpy, c->win, wm_hints);
+    if (n >= 8) {
+        /* WM_HINTS wire layout, window_group is missing from pre-ICCCM clients */
+        XWMHints wm_hints = {
+            .flags = v[0], .input = v[1], .initial_state = v[2],
+            .icon_pixmap = v[3], .icon_window = v[4], .icon_x = v[5], .icon_y = v[6],
+            .icon_mask = v[7], .window_group = n >= 9 ? v[8] : 0,
+        };
+        if (n < 9) {
+            wm_hints.flags &= ~WindowGroupHint;
+        }
+        if (c == mon->selected_client && wm_hints.flags & XUrgencyHint) {
+            wm_hints.flags &= ~XUrgencyHint;
+            XSetWMHints(dpy, c->cold->win, &wm_hints);
         } else {
-            c->is_urgent = (wm_hints->flags & XUrgencyHint) ? true : false;
+            c->is_urgent = (wm_hints.flags & XUrgencyHint) ? true : false;
         }
-        if (wm_hints->flags & InputHint) {
-            c->never_focus = !wm_hints->input;
+        if (wm_hints.flags & InputHint) {
+            c->cold->never_focus = !wm_hints.input;
         } else { 
-            c->never_focus = false;
+            c->cold->never_focus = false;
         }
-        XFree(wm_hints);
     }
 }
 
 void view(const Arg *arg)
 {
-    if ((arg->ui & TAGMASK) == first_monitor->tagset[first_monitor->seltags]) {
+    if ((arg->tags & TAGMASK) == first_monitor->tagset[first_monitor->seltags]) {
         return;
     }
+    first_monitor->pertag->tags[first_monitor->pertag->current_tag].selected = first_monitor->selected_client;
         /* Toggle sel tagset */
     first_monitor->seltags ^= 1; 
-    if (arg->ui & TAGMASK) {
-        first_monitor->tagset[first_monitor->seltags] = arg->ui & TAGMASK;
+    if (arg->tags & TAGMASK) {
+        first_monitor->tagset[first_monitor->seltags] = arg->tags & TAGMASK;
         first_monitor->pertag->previous_tag = first_monitor->pertag->current_tag;
 
-        if (arg->ui == 0) {
+        if (arg->tags == 0) {
             first_monitor->pertag->current_tag = 0;
         } else {
             unsigned int i = 0;
-            for (; !(arg->ui & 1 << i); i++);
+            for (; !(arg->tags & TAGBIT(i)); i++);
             first_monitor->pertag->current_tag = i + 1;
         }
     } else {
@@ -2028,8 +2776,13 @@ void view(const Arg *arg)
         first_monitor->pertag->current_tag = tmp_tag;
     }
 
-    first_monitor->master_factor = first_monitor->pertag->master_factors[first_monitor->pertag->current_tag];
-    focus(dpy, first_monitor, root,  NULL);
+    first_monitor->master_factor = first_monitor->pertag->tags[first_monitor->pertag->current_tag].master_factor;
+    first_monitor->nmaster = first_monitor->pertag->tags[first_monitor->pertag->current_tag].nmaster;
+    first_monitor->layout = first_monitor->pertag->tags[first_monitor->pertag->current_tag].layout;
+    /* The focus order of a tag is the shared stack filtered by its tags, so
+     * only the client it was left with needs remembering. focus() falls back
+     * to the stack if that client moved away. */
+    focus(dpy, first_monitor, root, first_monitor->pertag->tags[first_monitor->pertag->current_tag].selected);
     arrange(first_monitor);
 }
 
@@ -2045,10 +2798,12 @@ void check_another_wm_running(Display *dpy)
 }
 
 /* There's no way to check accesses to destroyed windows, thus those cases are ignored (especially on UnmapNotify's). 
+ * Requests wrapped in xerror_ignore_begin/end are matched by sequence number.
  * Other types of errors call Xlibs default error handler, which may call exit. */
 int xerror(Display *dpy, XErrorEvent *ee)
 {
-    if (ee->error_code == BadWindow
+    if (xerror_is_ignored(ee->serial)
+    || ee->error_code == BadWindow
     || (ee->request_code == X_SetInputFocus && ee->error_code == BadMatch)
     || (ee->request_code == X_PolyText8 && ee->error_code == BadDrawable)
     || (ee->request_code == X_PolyFillRectangle && ee->error_code == BadDrawable)
@@ -2065,8 +2820,8 @@ int xerror(Display *dpy, XErrorEvent *ee)
 
 void tag(const Arg *arg)
 {
-    if (first_monitor->selected_client && arg->ui & TAGMASK) {
-        first_monitor->selected_client->tags = arg->ui & TAGMASK;
+    if (first_monitor->selected_client && arg->tags & TAGMASK) {
+        first_monitor->selected_client->tags = arg->tags & TAGMASK;
         focus(dpy, first_monitor, root, NULL);
         arrange(first_monitor);
     }
@@ -2083,46 +2838,11 @@ int main(void)
     check_another_wm_running(dpy);
     setup();
     scan();
-    XEvent ev;
-    /* Main event loop */
     XSync(dpy, False);
-    while (running && !XNextEvent(dpy, &ev)) {
-        if (handler[ev.type]) {
-            /* Call handler */
-            handler[ev.type](&ev);
-        }
-    }
+    run();
     cleanup();
     XCloseDisplay(dpy);
     return EXIT_SUCCESS;
 }
 
-void tile(Monitor *m)
-{
-    unsigned int i, n, h, mw, my, ty;
-    Client *c = next_tiled_client(m->clients);
-
-    for (n = 0; c; c = next_tiled_client(c->next), n++);
-    if (n == 0) {
-        return;
-    }
-
-    if (n > 1) { 
-        mw = m->ww * m->master_factor;
-    } else { 
-        mw = m->ww;
-    }
-
-    for (i = my = ty = 0, c = next_tiled_client(m->clients); c; c = next_tiled_client(c->next), i++) {
-        if (i < 1) {
-            h = (m->wh - my) / (MIN(n, 1) - i);
-            resize(c, m->wx, m->wy + my, mw - (2*c->bw), h - (2*c->bw), false);
-            if (my + HEIGHT(c) < m->wh) my += HEIGHT(c);
-        } else {
-            h = (m->wh - ty) / (n - i);
-            resize(c, m->wx + mw, m->wy + ty, m->ww - mw - (2*c->bw), h - (2*c->bw),false);
-            if (ty + HEIGHT(c) < m->wh) ty += HEIGHT(c);
-        }
-    }
-}
 
@@ -0,0 +1,73 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "slab.h"
+#include "utils.h"
+
+/* Chunk header, the objects follow it at offset SLAB_LINE */
+struct SlabChunk {
+    SlabChunk *next;
+};
+
+/* Whole cache lines, so every object starts on a line of its own */
+static size_t slab_stride(const Slab *slab)
+{
+    size_t size = slab->size < sizeof(void *) ? sizeof(void *) : slab->size;
+    return (size + SLAB_LINE - 1) / SLAB_LINE * SLAB_LINE;
+}
+
+void *slab_alloc(Slab *slab)
+{
+    size_t stride = slab_stride(slab);
+    void *p;
+
+    if (slab->free_list) {
+        p = slab->free_list;
+        slab->free_list = *(void **)p;
+        slab->reused++;
+    } else {
+        if (!slab->fresh_left) {
+            void *mem;
+            if (posix_memalign(&mem, SLAB_LINE, SLAB_LINE + slab->per_chunk * stride)) {
+                die("posix_memalign:");
+            }
+            SlabChunk *chunk = mem;
+            chunk->next = slab->chunks;
+            slab->chunks = chunk;
+            slab->fresh = (char *)chunk + SLAB_LINE;
+            slab->fresh_left = slab->per_chunk;
+            slab->chunk_count++;
+        }
+        p = slab->fresh;
+        slab->fresh += stride;
+        slab->fresh_left--;
+    }
+    memset(p, 0, stride);
+    if (++slab->live > slab->peak) {
+        slab->peak = slab->live;
+    }
+    return p;
+}
+
+void slab_free(Slab *slab, void *p)
+{
+    if (!p) {
+        return;
+    }
+    *(void **)p = slab->free_list;
+    slab->free_list = p;
+    slab->live--;
+}
+
+void slab_deinit(Slab *slab)
+{
+    while (slab->chunks) {
+        SlabChunk *next = slab->chunks->next;
+        free(slab->chunks);
+        slab->chunks = next;
+    }
+    slab->free_list = NULL;
+    slab->fresh = NULL;
+    slab->fresh_left = 0;
+    slab->live = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef NDWM_SLAB_H
+#define NDWM_SLAB_H
+
+#include <stddef.h>
+
+#define SLAB_LINE 64 /* Cache line size in bytes */
+
+/* Fixed-size object allocator. Objects are carved out of chunks that are
+ * never returned to the heap before slab_deinit, and freed objects are
+ * handed out again before a new chunk is touched. Every object starts on a
+ * SLAB_LINE boundary and takes whole lines, so one that fits a line never
+ * straddles two. */
+typedef struct SlabChunk SlabChunk;
+
+typedef struct {
+    size_t size;           /* Object size as given to SLAB_INIT */
+    size_t per_chunk;
+    SlabChunk *chunks;
+    void *free_list;       /* Freed objects, linked through their first word */
+    char *fresh;           /* Never used objects left in the newest chunk */
+    size_t fresh_left;
+    unsigned long live, peak, reused, chunk_count;
+} Slab;
+
+#define SLAB_INIT(type, n) { sizeof(type), (n), NULL, NULL, NULL, 0, 0, 0, 0, 0 }
+
+void *slab_alloc(Slab *slab); /* Zeroed, dies on allocation failure */
+void slab_free(Slab *slab, void *p);
+void slab_deinit(Slab *slab);
+
+#endif
@@ -1,8 +1,12 @@
 #ifndef NDWM_ARG_H
 #define NDWM_ARG_H
 
+#include <stdint.h>
+
 typedef union {
+	int i;
 	unsigned int ui;
+	uint64_t tags;
 	const void *v;
 } Arg;
 
@@ -2,25 +2,69 @@
 #define NDWM_CLIENT_H
 
 #include <X11/Xutil.h>
+#include <stdint.h>
 #include "stdbool.h"
+#include "../layout.h"
 
 typedef struct Client Client;
 
-struct Client {
-	char name[256];
-	float mina, maxa;
-	int x, y, w, h;
-	int sfx, sfy, sfw, sfh; /* Stored float geometry, used on mode revert */
-	int oldx, oldy, oldw, oldh;
-	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
-	int bw, oldbw;
-	unsigned int tags;
-	int oldstate;
-	bool is_floating, is_fixed, is_urgent, is_fullscreen, never_focus;
-	Client *next;
-	Client *stack_next;
+typedef uint64_t Tagset; /* One bit per tag, so up to 64 tags */
+
+/* WM_PROTOCOLS the client advertises, cached in Client.protocols */
+enum {
+	ProtoTakeFocus   = 1 << 0,
+	ProtoDelete      = 1 << 1,
+	ProtoSyncRequest = 1 << 2,
+	ProtoPing        = 1 << 3,
+};
+
+/* Passive button grabs currently installed on a client window */
+enum { GrabNone, GrabFocused, GrabUnfocused };
+
+/* Fields off the layout, visibility and focus paths, kept out of Client */
+typedef struct {
+	/* Last layout slot and the geometry it produced, see apply_layout. First,
+	 * so a relayout reads one line of each tiled client. */
+	Rect slot, laid;
+	bool slot_sole;
+	bool is_fixed, never_focus;
+	Client *prev;                   /* Monitor client list, unused for systray icons */
 	Window win;
+	struct {
+		unsigned long border;
+		bool border_known, mapped;
+	} server; /* Rest of what was last sent to the X server, see Client.server */
+	int oldx, oldy, oldw, oldh, oldbw;
+	int oldstate;
+	unsigned int protocols;
+	int grab_state;
+	unsigned long hide_serial;      /* Request of the last unmap by client_hide, see unmap_notify */
+	bool iconic;                    /* WM_STATE set to IconicState by client_hide */
+	char name[256];
+	SizeHints hints;
+	int sfx, sfy, sfw, sfh;         /* Stored float geometry, used on mode revert */
+} ClientCold;
+
+/* One cache line of what the tile, showhide, focus and bar walks read and
+ * write. Geometry is 16 bit like in the X protocol. */
+struct Client {
+	Client *next;                   /* Monitor client list */
+	Client *stack_next, *stack_prev; /* Monitor focus stack */
+	ClientCold *cold;
+	Tagset tags;
+	int16_t x, y;
+	uint16_t w, h, bw;
+	struct {
+		int16_t x, y;
+		uint16_t w, h, bw;
+	} server; /* Geometry last sent to the X server for this window */
+	bool is_floating, is_urgent, is_fullscreen;
+	bool hidden;                    /* Unmapped by ndwm, see client_hide */
 };
 
+/* Outer size, border included */
+#define WIDTH(X)                    ((X)->w + 2 * (X)->bw)
+#define HEIGHT(X)                   ((X)->h + 2 * (X)->bw)
+
 #endif
 
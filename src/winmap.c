@@ -0,0 +1,94 @@
+#include <stdlib.h>
+
+#include "winmap.h"
+#include "utils.h"
+
+#define WINMAP_MIN_CAP 64
+
+/* XIDs are handed out sequentially per X client, so scatter them with a
+ * Fibonacci multiplier and fold the high bits in before masking. */
+static size_t winmap_slot(const WinMap *map, Window win)
+{
+    unsigned long long h = win * 11400714819323198485ull;
+    return (size_t)(h ^ (h >> 32)) & (map->cap - 1);
+}
+
+static void winmap_grow(WinMap *map)
+{
+    WinMap grown = { NULL, map->cap ? map->cap * 2 : WINMAP_MIN_CAP, 0 };
+
+    grown.entries = ecalloc(grown.cap, sizeof(WinMapEntry));
+    for (size_t i = 0; i < map->cap; i++) {
+        if (map->entries[i].win) {
+            winmap_insert(&grown, map->entries[i].win, map->entries[i].client);
+        }
+    }
+    free(map->entries);
+    *map = grown;
+}
+
+void winmap_insert(WinMap *map, Window win, Client *client)
+{
+    if (!win) {
+        return;
+    }
+    /* Keep the load factor at or below 1/2 so probe sequences stay short */
+    if ((map->len + 1) * 2 > map->cap) {
+        winmap_grow(map);
+    }
+    size_t i = winmap_slot(map, win);
+    for (; map->entries[i].win && map->entries[i].win != win; i = (i + 1) & (map->cap - 1));
+    if (!map->entries[i].win) {
+        map->len++;
+    }
+    map->entries[i].win = win;
+    map->entries[i].client = client;
+}
+
+void winmap_remove(WinMap *map, Window win)
+{
+    if (!win || !map->len) {
+        return;
+    }
+    size_t mask = map->cap - 1;
+    size_t i = winmap_slot(map, win);
+    for (; map->entries[i].win != win; i = (i + 1) & mask) {
+        if (!map->entries[i].win) {
+            return;
+        }
+    }
+    map->len--;
+
+    /* Backward-shift deletion: pull later members of the probe run into the
+     * hole so lookups never need tombstones. */
+    for (size_t j = (i + 1) & mask; map->entries[j].win; j = (j + 1) & mask) {
+        size_t home = winmap_slot(map, map->entries[j].win);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            map->entries[i] = map->entries[j];
+            i = j;
+        }
+    }
+    map->entries[i].win = None;
+    map->entries[i].client = NULL;
+}
+
+Client *winmap_lookup(const WinMap *map, Window win)
+{
+    if (!win || !map->len) {
+        return NULL;
+    }
+    size_t i = winmap_slot(map, win);
+    for (; map->entries[i].win; i = (i + 1) & (map->cap - 1)) {
+        if (map->entries[i].win == win) {
+            return map->entries[i].client;
+        }
+    }
+    return NULL;
+}
+
+void winmap_free(WinMap *map)
+{
+    free(map->entries);
+    map->entries = NULL;
+    map->cap = map->len = 0;
+}
@@ -0,0 +1,24 @@
+#ifndef NDWM_WINMAP_H
+#define NDWM_WINMAP_H
+
+#include <X11/Xlib.h>
+#include "types/client.h"
+
+/* Open-addressing (linear probing) index from a Window to its Client */
+typedef struct {
+    Window win;
+    Client *client;
+} WinMapEntry;
+
+typedef struct {
+    WinMapEntry *entries;
+    size_t cap;  /* Always zero or a power of two */
+    size_t len;
+} WinMap;
+
+void winmap_insert(WinMap *map, Window win, Client *client);
+void winmap_remove(WinMap *map, Window win);
+Client *winmap_lookup(const WinMap *map, Window win);
+void winmap_free(WinMap *map);
+
+#endif
@@ -1,9 +1,26 @@
 #include "xerror.h"
 #include "utils.h"
 
-int xerrordummy(Display *dpy, XErrorEvent *ee)
+#define XERROR_MAX_RANGES 64
+
+typedef struct {
+    unsigned long first, last;
+} SerialRange;
+
+/* Queue of ignored request ranges, oldest first and never overlapping */
+static SerialRange ranges[XERROR_MAX_RANGES];
+static unsigned int range_head = 0, range_count = 0;
+static unsigned long pending_first = 0;
+
+#define RANGE(I) ranges[(range_head + (I)) % XERROR_MAX_RANGES]
+
+/* Drops every range the server can no longer report errors for */
+static void ranges_prune(unsigned long below)
 {
-	return 0;
+    while (range_count && RANGE(0).last < below) {
+        range_head = (range_head + 1) % XERROR_MAX_RANGES;
+        range_count--;
+    }
 }
 
 int xerrorstart(Display *dpy, XErrorEvent *ee)
@@ -12,3 +29,39 @@ int xerrorstart(Display *dpy, XErrorEvent *ee)
 	return -1;
 }
 
+void xerror_ignore_begin(Display *dpy)
+{
+    if (range_count == XERROR_MAX_RANGES) {
+        /* Out of room: have the server answer everything sent so far while
+         * the ranges still cover it, after which none of them is needed */
+        XSync(dpy, False);
+        ranges_prune(LastKnownRequestProcessed(dpy) + 1);
+    }
+    pending_first = NextRequest(dpy);
+}
+
+void xerror_ignore_end(Display *dpy)
+{
+    unsigned long last = NextRequest(dpy) - 1;
+
+    if (last < pending_first) {
+        return;
+    }
+    /* Errors for requests Xlib has already read past have been handled */
+    ranges_prune(LastKnownRequestProcessed(dpy) + 1);
+    if (range_count && RANGE(range_count - 1).last + 1 >= pending_first) {
+        /* Adjacent: widen the newest range instead */
+        RANGE(range_count - 1).last = last;
+        return;
+    }
+    RANGE(range_count).first = pending_first;
+    RANGE(range_count).last = last;
+    range_count++;
+}
+
+bool xerror_is_ignored(unsigned long serial)
+{
+    /* Errors arrive in request order, nothing older can still show up */
+    ranges_prune(serial);
+    return range_count && RANGE(0).first <= serial;
+}
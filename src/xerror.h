@@ -1,10 +1,19 @@
 #ifndef NDWM_XERROR_H
 #define NDWM_XERROR_H
 
+#include <stdbool.h>
 #include <X11/Xutil.h>
 
 // Xerror utils
-int xerrordummy(Display *dpy, XErrorEvent *ee);
 int xerrorstart(Display *dpy, XErrorEvent *ee);
 
+/* Requests issued between begin and end are allowed to fail. Their
+ * sequence numbers are remembered so the error handler can recognise the
+ * errors when they arrive later, without an XSync round trip. Only when
+ * too many ranges are outstanding does begin sync to retire them. Pairs
+ * do not nest. */
+void xerror_ignore_begin(Display *dpy);
+void xerror_ignore_end(Display *dpy);
+bool xerror_is_ignored(unsigned long serial);
+
 #endif